@@ -1,101 +1,149 @@
 #include "cartridge.hpp"
-#include "mapper000.hpp"
 
-#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <utility>
 
-cartridge::cartridge()
+namespace
+{
+// The ROM's path with .sav in place of its extension
+auto save_path(const std::string& rom_path) -> std::string
 {
+    size_t name = rom_path.find_last_of('/');
+    size_t extension = rom_path.find_last_of('.');
 
+    bool has_extension = extension != std::string::npos and (name == std::string::npos or extension > name);
+
+    return (has_extension ? rom_path.substr(0, extension) : rom_path) + ".sav";
 }
+}  // namespace
 
-auto cartridge::open_rom_file(std::string rom_path) -> bool
+cartridge::cartridge()
+    : m_mapper(std::in_place_type<mapper000>, mapper::memory {})
+{
+    m_banks = &std::get<mapper000>(m_mapper);
+}
+
+auto cartridge::header() const -> const ines_header&
 {
-    bool load_success = true;
+    return m_image->header();
+}
 
-    std::ifstream rom(rom_path, std::ifstream::binary);
+auto cartridge::save_ppu_view(ppu_view& view) const -> void
+{
+    const mapper::memory& memory = m_banks->rom();
 
-    if (!rom)
+    if (memory.chr_ram)
     {
-        printf("ERROR: Invalid ROM file! (check file name / path)\n");
-        load_success = false;
+        view.image = nullptr;
+        view.chr_rom = nullptr;
+        view.chr_rom_size = 0;
+        view.chr_ram.assign(memory.chr, memory.chr + memory.chr_size);
     }
     else
     {
-        char header[16];
-        rom.read(header, 16);
+        view.image = m_image;
+        view.chr_rom = memory.chr;
+        view.chr_rom_size = memory.chr_size;
+        view.chr_ram.clear();
+    }
+
+    for (int window = 0; window < mapper::chr_window_count; ++window)
+    {
+        view.chr_pages[window] = static_cast<uint16_t>(chr_page(window));
+    }
+    for (int table = 0; table < 4; ++table)
+    {
+        view.nametables[table] = nametable_offset(static_cast<uint16_t>(0x2000 + table * 0x400));
+    }
+}
+
+auto cartridge::open_rom_file(std::string rom_path) -> bool
+{
+    std::shared_ptr<const rom_image> image = rom_image::open(rom_path);
+    bool load_success = image != nullptr;
+
+    if (load_success)
+    {
+        const ines_header& header = image->header();
+
+        // PRG and CHR-ROM are shared with every other cartridge running this
+        // ROM. What this cartridge can write is one block of its own, laid
+        // out as PRG-RAM, battery-backed CHR-RAM, CHR-RAM (so each kind is
+        // contiguous, and a snapshot is one copy). Battery-backed PRG-RAM
+        // is the save file's.
+        int prg_ram_size = header.prg_ram_size;
+        int chr_ram_size = header.chr_nvram_size + header.chr_ram_size;
+
+        // Plenty of NES 2.0 headers leave CHR-RAM out; without CHR-ROM there
+        // has to be some
+        bool has_chr_ram = image->chr_rom_size() == 0;
+        if (has_chr_ram and chr_ram_size == 0)
+        {
+            chr_ram_size = default_chr_ram_size;
+        }
 
-        if (header[0] != 'N'
-            and header[1] != 'E'
-            and header[2] != 'S'
-            and header[3] != '\n')
+        std::vector<uint8_t> ram(prg_ram_size + chr_ram_size);
+        uint8_t* chr_ram = ram.data() + prg_ram_size;
+
+        mapper::memory memory {image->prg_rom(),
+                               image->prg_rom_size(),
+                               has_chr_ram ? chr_ram : image->chr_rom(),
+                               has_chr_ram ? chr_ram_size : image->chr_rom_size(),
+                               has_chr_ram,
+                               header.vertical_mirroring};
+
+        // A mapper we don't have leaves the cartridge as it was. Boards built
+        // from plain logic chips are looked up in a table rather than listed
+        // here (see discrete_mapper.hpp).
+        const discrete_mapper::board* board = discrete_mapper::find(header.mapper);
+
+        switch (header.mapper)
         {
-            load_success = false;
+            case 0:
+                m_mapper.emplace<mapper000>(memory);
+                break;
+            case 1:
+                m_mapper.emplace<mapper001>(memory);
+                break;
+            case 4:
+                m_mapper.emplace<mapper004>(memory);
+                break;
+            default:
+                if (board != nullptr)
+                {
+                    m_mapper.emplace<discrete_mapper>(memory, *board);
+                }
+                else
+                {
+                    fprintf(stderr, "could not create mapper! iNES mapper #: %3d\n", header.mapper);
+                    fprintf(stderr, "mapper is probably unimplemented.\n");
+                    load_success = false;
+                }
+                break;
         }
 
+        // Moving these doesn't move what the mapper points at
         if (load_success)
         {
-            /*
-                I don't think whether or not the file is 1.0 or 2.0 matters
-            */
-            // if (!header[7] & 0b000 and (header[7] & 0b1000) == 0b1000)
-            // {
-            //     printf("iNES 2.0 File\n\n");
-            // }
-            // else
-            // {
-            //     printf("Standard iNES file\n\n");
-            // }
-
-            int prg_rom_lsb = static_cast<uint16_t>(header[4]);
-            int chr_rom_lsb = static_cast<uint16_t>(header[5]);
-            int prg_rom_msb = static_cast<uint16_t>(header[9] & 0x0F);
-            int chr_rom_msb = static_cast<uint16_t>(header[9] & 0xF0);
-
-            int prg_rom_size = ((prg_rom_msb << 8) | prg_rom_lsb) * prg_rom_bank_size;
-            int chr_rom_size = ((chr_rom_msb << 8) | chr_rom_lsb) * chr_rom_bank_size;
-
-            printf("PRG-ROM Size (bytes): \t%d\n", prg_rom_size);
-            printf("CHR-ROM Size (bytes): \t%d\n", chr_rom_size);
-
-            m_vertically_mirrored = (header[6] & 0b0001) == 0b0001; 
-            bool has_battery = (header[6] & 0b0010) == 0b0010;
-            bool has_trainer = (header[6] & 0b0100) == 0b0100;
-            bool four_screen = (header[6] & 0b1000) == 0b1000;
-
-            int mapper_number = (header[6] >> 4);
-
-            printf("Vertically mapped: \t\t%s\n", m_vertically_mirrored ? "true" : "false");
-            printf("Battery backup: \t\t%s\n", has_battery ? "true" : "false");
-            printf("Trainer in ROM: \t\t%s\n", has_trainer ? "true" : "false");
-            printf("4 Screen Mode: \t\t%s\n", four_screen ? "true" : "false");
-
-            /*
-                Gonna ignore these for now
-            */
-            // uint16_t prg_ram_shift_count = (header[10] & 0x0F);
-            // uint16_t prg_eeprom_shift_count = (header[10] & 0xF0);
-            // uint16_t chr_ram_shift_count = (header[10] & 0x0F);
-            // uint16_t chr_nvram_shift_count = (header[10] & 0xF0);
-
-            if (has_trainer)
-            {
-                rom.seekg(512, std::ios_base::cur);
-            }
+            m_image = std::move(image);
+            m_ram = std::move(ram);
+            m_banks = std::visit([](auto& m) -> mapper* { return &m; }, m_mapper);
 
-            m_prg_rom.resize(prg_rom_size);
-            rom.read(reinterpret_cast<char*>(m_prg_rom.data()), m_prg_rom.size());
-            m_chr_rom.resize(chr_rom_size);
-            rom.read(reinterpret_cast<char*>(m_chr_rom.data()), m_chr_rom.size());
+            open_save(save_path(rom_path), header.prg_nvram_size);
 
-            switch (mapper_number)
+            // $6000-$7FFF shows battery-backed RAM if there's any, and
+            // mirrors anything smaller than 8 KB
+            m_prg_ram = nullptr;
+            if (header.prg_nvram_size > 0)
             {
-                case 0:
-                    m_mapper = std::make_shared<mapper000>(prg_rom_lsb, chr_rom_lsb);
-                    break;
-                default:
-                    fprintf(stderr, "could not create mapper! iNES mapper #: %3d\n", mapper_number);
-                    fprintf(stderr, "mapper is probably unimplemented.\n");
-                    break;
+                m_prg_ram = m_save_ram;
+                m_prg_ram_mask = static_cast<uint16_t>(std::min(header.prg_nvram_size, 0x2000) - 1);
+            }
+            else if (prg_ram_size > 0)
+            {
+                m_prg_ram = m_ram.data();
+                m_prg_ram_mask = static_cast<uint16_t>(std::min(prg_ram_size, 0x2000) - 1);
             }
         }
     }
@@ -103,62 +151,73 @@ auto cartridge::open_rom_file(std::string rom_path) -> bool
     return load_success;
 }
 
-auto cartridge::cpu_read(uint16_t addr, uint8_t& byte) -> bool
+auto cartridge::open_save(const std::string& path, int size) -> void
 {
-    bool success = false;
-    int mapped_addr = 0;
+    m_save.reset();
+    m_private_save.clear();
+    m_save_ram = nullptr;
 
-    if (m_mapper->cpu_read(addr, mapped_addr))
+    if (size > 0)
     {
-        byte = m_prg_rom[mapped_addr];
-        success = true;
-    }
+        m_save = std::make_unique<save_file>();
 
-    return success;
+        if (m_save->open(path, size))
+        {
+            m_save_ram = m_save->data();
+        }
+        else
+        {
+            // Most likely another cartridge is running the same game. This
+            // one starts from the same save, but what it writes is lost.
+            printf("NOTE: %s can't be opened for writing (in use?); saves from this game won't be kept\n", path.c_str());
+            m_save.reset();
+            m_private_save.resize(size);
+
+            mapped_file existing;
+            if (existing.open(path))
+            {
+                memcpy(m_private_save.data(), existing.data(), std::min(existing.size(), m_private_save.size()));
+            }
+
+            m_save_ram = m_private_save.data();
+        }
+    }
 }
 
 auto cartridge::cpu_write(uint16_t addr, uint8_t byte) -> bool
 {
     bool success = false;
-    int mapped_addr = 0;
 
-    if (m_mapper->cpu_read(addr, mapped_addr))
+    if (addr >= 0x8000)
     {
-        m_prg_rom[mapped_addr] = byte;
-        success = true;
+        // Only bank registers live up here, and they never change what's in
+        // ROM
+        std::visit([&](auto& m) { m.cpu_write(addr, byte); }, m_mapper);
     }
-
-    return success;
-}
-
-auto cartridge::ppu_read(uint16_t addr, uint8_t& byte) -> bool
-{
-    bool success = false;
-    int mapped_addr = 0;
-
-    if (m_mapper->ppu_read(addr, mapped_addr))
+    else if (addr >= 0x6000 and m_prg_ram != nullptr and m_banks->prg_ram_enabled())
     {
-        byte = m_chr_rom[mapped_addr];
+        m_prg_ram[addr & m_prg_ram_mask] = byte;
+        if (m_save != nullptr)
+        {
+            m_save->mark_dirty();
+        }
         success = true;
     }
 
     return success;
 }
 
-auto cartridge::ppu_write(uint16_t addr, uint8_t byte) -> bool
+auto cartridge::scanline() -> void
 {
-    bool success = false;
-    int mapped_addr = 0;
-
-    if (m_mapper->ppu_write(addr, mapped_addr))
-    {
-        m_chr_rom[mapped_addr] = byte;
-        success = true;
-    }
+    std::visit([](auto& m) { m.scanline(); }, m_mapper);
+}
 
-    return success;
+auto cartridge::ram() -> uint8_t*
+{
+    return m_ram.data();
 }
-auto cartridge::get_mirroring() const -> bool
+
+auto cartridge::ram_size() const -> size_t
 {
-    return m_vertically_mirrored;
+    return m_ram.size();
 }
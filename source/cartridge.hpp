@@ -1,30 +1,180 @@
+#include <array>
 #include <string>
 #include <vector>
 #include <memory>
 #include <cstdint>
+#include <variant>
 
-#include "mapper.hpp"
+#include "discrete_mapper.hpp"
+#include "mapper000.hpp"
+#include "mapper001.hpp"
+#include "mapper004.hpp"
+#include "rom_image.hpp"
+#include "save_file.hpp"
 
 class cartridge
 {
-    bool m_vertically_mirrored;
+public:
+    // What the PPU sees of the cartridge at one moment: the 1 KB CHR page in
+    // each window, where each nametable lands in VRAM, and CHR itself (the
+    // ROM, kept alive by holding its image, or a copy of CHR-RAM). A replica
+    // PPU draws from one of these, since the live cartridge moves on while
+    // it works.
+    struct ppu_view
+    {
+        std::shared_ptr<const rom_image> image;
+        const uint8_t* chr_rom = nullptr;
+        int chr_rom_size = 0;
+        std::vector<uint8_t> chr_ram;
+
+        std::array<uint16_t, mapper::chr_window_count> chr_pages = {};
+        std::array<uint16_t, 4> nametables = {};
+    };
+
+private:
+    static constexpr int default_chr_ram_size = 0x2000;
+
+    // The ROM itself, shared with any other cartridge running the same
+    // game; RAM and the mapper's bank registers are this cartridge's own.
+    // m_ram holds PRG-RAM, then CHR-RAM.
+    std::shared_ptr<const rom_image> m_image;
+    std::vector<uint8_t> m_ram;
+
+    // Battery-backed PRG-RAM: the .sav file next to the ROM, mapped into
+    // memory, or a private copy of it when that can't be opened
+    std::unique_ptr<save_file> m_save;
+    std::vector<uint8_t> m_private_save;
+    uint8_t* m_save_ram = nullptr;
 
-    const int prg_rom_bank_size = 0x4000;
-    const int chr_rom_bank_size = 0x2000;
+    // What $6000-$7FFF shows, or nullptr for open bus
+    uint8_t* m_prg_ram = nullptr;
+    uint16_t m_prg_ram_mask = 0;
 
-    std::vector<uint8_t> m_prg_rom;
-    std::vector<uint8_t> m_chr_rom;
+    // Every mapper there is, held by value so register writes never go
+    // through a virtual call (see mapper.hpp). Reads use m_banks, the active
+    // mapper's bank windows, without looking at which mapper it is.
+    std::variant<mapper000, mapper001, mapper004, discrete_mapper> m_mapper;
+    mapper* m_banks;
+
+    auto open_save(const std::string& path, int size) -> void;
 
-     std::shared_ptr<mapper> m_mapper;
-    
 public:
     cartridge();
 
-    auto get_mirroring() const -> bool;
+    // The mappers point into m_ram, so a copy would write the original's
+    cartridge(const cartridge&) = delete;
+    auto operator=(const cartridge&) -> cartridge& = delete;
 
     auto open_rom_file(std::string rom_path) -> bool;
+
+    // The loaded ROM's header; only once open_rom_file() has succeeded
+    auto header() const -> const ines_header&;
+
+    // Every byte on the cartridge that can change, as one block (see m_ram),
+    // apart from battery-backed PRG-RAM
+    auto ram() -> uint8_t*;
+    auto ram_size() const -> size_t;
+
     auto cpu_read(uint16_t addr, uint8_t &byte) -> bool;
     auto cpu_write(uint16_t addr, uint8_t byte) -> bool;
     auto ppu_read(uint16_t addr, uint8_t &byte) -> bool;
     auto ppu_write(uint16_t addr, uint8_t byte) -> bool;
-};
\ No newline at end of file
+
+    // Where a nametable address lands in the PPU's VRAM
+    auto nametable_offset(uint16_t addr) const -> uint16_t;
+
+    // Moves whenever the mapper switches CHR banks or mirroring
+    auto ppu_generation() const -> uint32_t;
+
+    // For caches of what the windows show (see mapper.hpp)
+    auto prg_generation(int window) const -> uint32_t;
+    auto chr_generation(int window) const -> uint32_t;
+    auto generation() const -> uint32_t;
+
+    // Which 1 KB page of CHR a PPU window shows, and all of it at once
+    auto chr_page(int window) const -> int;
+    auto save_ppu_view(ppu_view& view) const -> void;
+
+    // The mapper's IRQ line, and the PPU's once-a-line clock for mappers that
+    // count scanlines
+    auto irq() const -> bool;
+    auto scanline() -> void;
+};
+
+inline auto cartridge::cpu_read(uint16_t addr, uint8_t& byte) -> bool
+{
+    bool success = false;
+
+    if (addr >= 0x8000)
+    {
+        byte = m_banks->prg_read(addr);
+        success = true;
+    }
+    else if (addr >= 0x6000 and m_prg_ram != nullptr and m_banks->prg_ram_enabled())
+    {
+        byte = m_prg_ram[addr & m_prg_ram_mask];
+        success = true;
+    }
+
+    return success;
+}
+
+inline auto cartridge::ppu_read(uint16_t addr, uint8_t& byte) -> bool
+{
+    bool success = false;
+
+    if (addr <= 0x1FFF)
+    {
+        byte = m_banks->chr_read(addr);
+        success = true;
+    }
+
+    return success;
+}
+
+inline auto cartridge::ppu_write(uint16_t addr, uint8_t byte) -> bool
+{
+    bool success = false;
+
+    if (addr <= 0x1FFF)
+    {
+        success = m_banks->chr_write(addr, byte);
+    }
+
+    return success;
+}
+
+inline auto cartridge::nametable_offset(uint16_t addr) const -> uint16_t
+{
+    return m_banks->nametable_offset(addr);
+}
+
+inline auto cartridge::ppu_generation() const -> uint32_t
+{
+    return m_banks->ppu_generation();
+}
+
+inline auto cartridge::prg_generation(int window) const -> uint32_t
+{
+    return m_banks->prg_generation(window);
+}
+
+inline auto cartridge::chr_generation(int window) const -> uint32_t
+{
+    return m_banks->chr_generation(window);
+}
+
+inline auto cartridge::generation() const -> uint32_t
+{
+    return m_banks->generation();
+}
+
+inline auto cartridge::chr_page(int window) const -> int
+{
+    return m_banks->chr_page(window);
+}
+
+inline auto cartridge::irq() const -> bool
+{
+    return m_banks->irq();
+}
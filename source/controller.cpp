@@ -11,8 +11,6 @@ controller::controller(SDL_Event& input) : m_input(input)
 
 void controller::get_input()
 {
-    m_status = 0;
-
     if (m_input.type == SDL_KEYDOWN /*and m_input.key.repeat == 0*/)
     {
         auto keys = m_input.key.keysym.sym;
@@ -5,6 +5,8 @@
 #ifndef CYGNES_CONTROLLER_HPP
 #define CYGNES_CONTROLLER_HPP
 
+#include <atomic>
+
 #include "SDL.h"
 
 class controller
@@ -23,14 +25,15 @@ class controller
     SDL_KeyCode m_btn_left = SDLK_LEFT;
     SDL_KeyCode m_btn_right = SDLK_RIGHT;
 
-    bool m_a_pressed = false;
-    bool m_b_pressed = false;
-    bool m_select_pressed = false;
-    bool m_start_pressed = false;
-    bool m_up_pressed = false;
-    bool m_down_pressed = false;
-    bool m_left_pressed = false;
-    bool m_right_pressed = false;
+    // Written by the event loop, read by the emulation thread
+    std::atomic<bool> m_a_pressed {false};
+    std::atomic<bool> m_b_pressed {false};
+    std::atomic<bool> m_select_pressed {false};
+    std::atomic<bool> m_start_pressed {false};
+    std::atomic<bool> m_up_pressed {false};
+    std::atomic<bool> m_down_pressed {false};
+    std::atomic<bool> m_left_pressed {false};
+    std::atomic<bool> m_right_pressed {false};
 
   public:
     controller(SDL_Event& input);
@@ -49,7 +49,7 @@ auto cpu::read(uint16_t addr) -> uint8_t
         case 0x2000 ... 0x3FFF:
             byte = m_ppu->reg_read(addr & 0x07);
             break;
-        case 0x8000 ... 0xFFFF:
+        case 0x6000 ... 0xFFFF:
             m_cart->cpu_read(addr, byte);
             break;
         case 0x4016:
@@ -78,8 +78,16 @@ auto cpu::write(uint16_t addr, uint8_t byte) -> void
         case 0x2000 ... 0x3FFF:
             m_ppu->reg_write(addr & 0x07, byte);
             break;
-        case 0x8000 ... 0xFFFF:
+        case 0x6000 ... 0xFFFF:
             m_cart->cpu_write(addr, byte);
+
+            // CHR banks and mirroring change what the PPU draws without it
+            // seeing a write of its own
+            if (m_cart->ppu_generation() != m_cart_ppu_generation)
+            {
+                m_cart_ppu_generation = m_cart->ppu_generation();
+                m_ppu->invalidate_frame();
+            }
             break;
         case 0x4014:
             printf("NOTE: DMA from page $%02X of RAM into PPU\n", byte);
@@ -1840,6 +1848,12 @@ auto cpu::step() -> void
     {
         nonmaskable_interrupt();
     }
+    else if (m_cycles == 0 and !m_try_transfer and m_cart->irq())
+    {
+        // The line stays up until the game acknowledges it, so it's enough
+        // to look between instructions; with I set this does nothing
+        interrupt_request();
+    }
 
     if (!m_try_transfer)
     {
@@ -1881,3 +1895,33 @@ auto cpu::connect_controller(std::shared_ptr<controller>& ctrl) -> void
 {
     this->m_controller_a = ctrl;
 }
+
+auto cpu::connect_frame_buffer(std::shared_ptr<frame_buffer>& frames) -> void
+{
+    m_ppu->connect_frame_buffer(frames);
+}
+
+auto cpu::set_frame_skip(int frames) -> void
+{
+    m_ppu->set_frame_skip(frames);
+}
+
+auto cpu::set_behind_schedule(bool behind) -> void
+{
+    m_ppu->set_behind_schedule(behind);
+}
+
+auto cpu::frame_count() const -> uint64_t
+{
+    return m_ppu->frame_count();
+}
+
+auto cpu::static_frames() const -> uint64_t
+{
+    return m_ppu->static_frames();
+}
+
+auto cpu::set_pipelined(bool pipelined, int band_workers) -> void
+{
+    m_ppu->set_pipelined(pipelined, band_workers);
+}
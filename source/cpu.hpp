@@ -28,6 +28,9 @@ class cpu
     // Other pieces of hardware the CPU needs to see
     std::shared_ptr<cartridge> m_cart = nullptr;
     std::unique_ptr<ppu> m_ppu = nullptr;
+
+    // The cartridge's ppu_generation() as of the PPU's last invalidation
+    uint32_t m_cart_ppu_generation = 0;
     std::shared_ptr<controller> m_controller_a = nullptr;
     uint8_t m_controller_a_state;
 
@@ -182,6 +185,13 @@ class cpu
 
     auto connect_cartridge(std::shared_ptr<cartridge>& cart) -> void;
     auto connect_controller(std::shared_ptr<controller>& ctrl) -> void;
+    auto connect_frame_buffer(std::shared_ptr<frame_buffer>& frames) -> void;
+
+    auto set_frame_skip(int frames) -> void;
+    auto set_behind_schedule(bool behind) -> void;
+    auto frame_count() const -> uint64_t;
+    auto static_frames() const -> uint64_t;
+    auto set_pipelined(bool pipelined, int band_workers) -> void;
 
     auto clock() -> void;
     auto step() -> void;
@@ -0,0 +1,75 @@
+#include "discrete_mapper.hpp"
+
+namespace
+{
+constexpr discrete_mapper::board boards[] = {
+    // number, PRG bits, CHR bits, mirroring bit, PRG bank size, bus conflicts
+    {2, 0x0F, 0x00, 0x00, 0x4000, true},   // UxROM
+    {3, 0x00, 0xFF, 0x00, 0x8000, true},   // CNROM
+    {7, 0x07, 0x00, 0x10, 0x8000, false},  // AxROM
+    {11, 0x03, 0xF0, 0x00, 0x8000, false}, // Color Dreams
+    {66, 0x30, 0x03, 0x00, 0x8000, true},  // GxROM
+};
+
+// The value of the bits in mask, shifted down to bit 0
+auto field(uint8_t byte, uint8_t mask) -> int
+{
+    return mask == 0 ? 0 : (byte & mask) >> __builtin_ctz(mask);
+}
+}  // namespace
+
+auto discrete_mapper::find(int number) -> const board*
+{
+    const board* found = nullptr;
+
+    for (const board& candidate : boards)
+    {
+        if (candidate.number == number)
+        {
+            found = &candidate;
+        }
+    }
+
+    return found;
+}
+
+discrete_mapper::discrete_mapper(const memory& rom, const board& layout)
+    : mapper(rom)
+    , m_board(&layout)
+{
+    // What the latch doesn't switch stays where power-on puts it: the last
+    // PRG bank at $C000 on 16 KB boards, and CHR as it is in the file
+    int last_bank = (prg_banks - 1) * 0x4000;
+    map_prg(2, last_bank);
+    map_prg(3, last_bank + prg_window_size);
+
+    for (int window = 0; window < chr_window_count; ++window)
+    {
+        map_chr(window, window * chr_window_size);
+    }
+
+    update_banks();
+}
+
+auto discrete_mapper::update_banks() -> void
+{
+    int prg_offset = field(m_latch, m_board->prg_bits) * m_board->prg_bank_size;
+    for (int window = 0; window < m_board->prg_bank_size / prg_window_size; ++window)
+    {
+        map_prg(window, prg_offset + window * prg_window_size);
+    }
+
+    if (m_board->chr_bits != 0)
+    {
+        int chr_offset = field(m_latch, m_board->chr_bits) * 0x2000;
+        for (int window = 0; window < chr_window_count; ++window)
+        {
+            map_chr(window, chr_offset + window * chr_window_size);
+        }
+    }
+
+    if (m_board->mirroring_bit != 0)
+    {
+        set_mirroring((m_latch & m_board->mirroring_bit) != 0 ? mirroring::single_upper : mirroring::single_lower);
+    }
+}
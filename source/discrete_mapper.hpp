@@ -0,0 +1,70 @@
+#ifndef CYGNES_DISCRETE_MAPPER_HPP
+#define CYGNES_DISCRETE_MAPPER_HPP
+
+#include "mapper.hpp"
+
+/*
+ * The boards whose "mapper" is a latch or two of plain logic chips: a write
+ * anywhere in $8000-$FFFF stores the byte, and fixed groups of its bits pick
+ * a PRG bank, a CHR bank and on some boards the nametable page. They differ
+ * only in which bits go where, so each is a board descriptor in a table
+ * (discrete_mapper.cpp) rather than a class, and one implementation repoints
+ * the windows for all of them. A new board of this kind is one more line in
+ * that table.
+ *
+ * Reads go through the same window tables as any other mapper's, so these
+ * boards cost exactly what NROM does until a bank is switched.
+ */
+class discrete_mapper : public mapper
+{
+  public:
+    struct board
+    {
+        // iNES mapper number
+        int number;
+
+        // Bits of the latched byte that pick the PRG bank, the 8 KB CHR bank
+        // and the one-screen nametable page; 0 where the board doesn't
+        // switch that (its mirroring then comes from the header)
+        uint8_t prg_bits;
+        uint8_t chr_bits;
+        uint8_t mirroring_bit;
+
+        // 0x8000 switches all of $8000-$FFFF; 0x4000 switches $8000 and
+        // fixes the last bank at $C000
+        int prg_bank_size;
+
+        // The ROM drives the data bus too when the latch is written, so the
+        // latch gets the written byte ANDed with the ROM byte at that address
+        bool bus_conflicts;
+    };
+
+    // The board for an iNES mapper number, or nullptr if it isn't one of
+    // these
+    static auto find(int number) -> const board*;
+
+    discrete_mapper(const memory& rom, const board& layout);
+    auto cpu_write(uint16_t addr, uint8_t byte) -> void;
+
+  private:
+    const board* m_board;
+    uint8_t m_latch = 0;
+
+    auto update_banks() -> void;
+};
+
+inline auto discrete_mapper::cpu_write(uint16_t addr, uint8_t byte) -> void
+{
+    if (m_board->bus_conflicts)
+    {
+        byte &= prg_read(addr);
+    }
+
+    if (byte != m_latch)
+    {
+        m_latch = byte;
+        update_banks();
+    }
+}
+
+#endif  // CYGNES_DISCRETE_MAPPER_HPP
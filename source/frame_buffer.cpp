@@ -0,0 +1,139 @@
+#include "frame_buffer.hpp"
+
+#include <algorithm>
+#include <new>
+
+namespace
+{
+auto round_up(size_t size, size_t multiple) -> size_t
+{
+    return (size + multiple - 1) / multiple * multiple;
+}
+}  // namespace
+
+frame_buffer::frame_buffer(pixel_format format)
+    : m_format(format)
+{
+    size_t colors_size = round_up(pixel_count * (m_format == argb ? sizeof(uint32_t) : sizeof(uint8_t)), alignment);
+    size_t emphasis_size = m_format == argb ? 0 : round_up(height, alignment);
+    size_t slot_size = colors_size + emphasis_size;
+
+    m_storage.reset(static_cast<uint8_t*>(std::aligned_alloc(alignment, slot_size * slot_count)));
+
+    // Fail the way new would rather than draw into nothing
+    if (m_storage == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    for (int slot = 0; slot < slot_count; ++slot)
+    {
+        uint8_t* base = m_storage.get() + slot * slot_size;
+
+        if (m_format == argb)
+        {
+            m_slots[slot] = reinterpret_cast<uint32_t*>(base);
+            std::fill_n(m_slots[slot], pixel_count, 0xFF000000);
+        }
+        else
+        {
+            m_index_slots[slot] = base;
+            m_emphasis_slots[slot] = base + colors_size;
+            std::fill_n(m_index_slots[slot], pixel_count, 0x0F);
+            std::fill_n(m_emphasis_slots[slot], height, 0);
+        }
+    }
+}
+
+auto frame_buffer::aligned_free::operator()(void* memory) const -> void
+{
+    std::free(memory);
+}
+
+auto frame_buffer::format() const -> pixel_format
+{
+    return m_format;
+}
+
+auto frame_buffer::back() -> uint32_t*
+{
+    return m_slots[m_back];
+}
+
+auto frame_buffer::back_indices() -> uint8_t*
+{
+    return m_index_slots[m_back];
+}
+
+auto frame_buffer::back_emphasis() -> uint8_t*
+{
+    return m_emphasis_slots[m_back];
+}
+
+auto frame_buffer::publish() -> void
+{
+    uint8_t previous = m_ready.exchange(m_back | fresh_bit, std::memory_order_acq_rel);
+
+    // The presenter never picked up the last frame, so it's gone for good
+    if ((previous & fresh_bit) == fresh_bit)
+    {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    m_previous = m_back;
+    m_back = previous & index_mask;
+    m_published.fetch_add(1, std::memory_order_relaxed);
+}
+
+auto frame_buffer::previous() const -> const uint32_t*
+{
+    return m_slots[m_previous];
+}
+
+auto frame_buffer::previous_indices() const -> const uint8_t*
+{
+    return m_index_slots[m_previous];
+}
+
+auto frame_buffer::previous_emphasis() const -> const uint8_t*
+{
+    return m_emphasis_slots[m_previous];
+}
+
+auto frame_buffer::acquire() -> bool
+{
+    bool success = false;
+
+    if ((m_ready.load(std::memory_order_acquire) & fresh_bit) == fresh_bit)
+    {
+        m_front = m_ready.exchange(m_front, std::memory_order_acq_rel) & index_mask;
+        success = true;
+    }
+
+    return success;
+}
+
+auto frame_buffer::front() const -> const uint32_t*
+{
+    return m_slots[m_front];
+}
+
+auto frame_buffer::front_indices() const -> const uint8_t*
+{
+    return m_index_slots[m_front];
+}
+
+auto frame_buffer::front_emphasis() const -> const uint8_t*
+{
+    return m_emphasis_slots[m_front];
+}
+
+auto frame_buffer::frames_published() const -> uint64_t
+{
+    return m_published.load(std::memory_order_relaxed);
+}
+
+auto frame_buffer::frames_dropped() const -> uint64_t
+{
+    return m_dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,99 @@
+#ifndef CYGNES_FRAME_BUFFER_HPP
+#define CYGNES_FRAME_BUFFER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+
+/*
+ * Triple-buffered hand-off of finished frames from the PPU to the presenter.
+ *
+ * The PPU only ever touches the back slot and the presenter only ever touches
+ * the front slot. The third slot holds the most recently finished frame, and
+ * ownership of it is traded with a single atomic exchange, so neither side
+ * ever waits on the other.
+ */
+class frame_buffer
+{
+  public:
+    static const int width = 256;
+    static const int height = 240;
+    static const int pixel_count = width * height;
+    static const int pitch = width * sizeof(uint32_t);
+
+    // Every slot and row starts on a cache line, so nothing written by the
+    // PPU shares a line with what the presenter is reading, and rows can be
+    // handed to SDL (or SIMD loads) by pointer as they are
+    static const int alignment = 64;
+    static_assert(pitch % alignment == 0, "rows must stay aligned");
+
+    // What the PPU writes for each pixel: a finished ARGB word, or a byte
+    // holding the 6-bit palette color, with the three emphasis bits kept once
+    // per line. Index frames are a quarter of the size, and suit consumers
+    // that do their own color conversion (the NTSC filter), convert at
+    // present time (palette::to_argb) or never need colors at all.
+    enum pixel_format
+    {
+        argb,
+        palette_index
+    };
+
+    explicit frame_buffer(pixel_format format = argb);
+
+    auto format() const -> pixel_format;
+
+    // Producer (PPU) side
+    auto back() -> uint32_t*;
+    auto back_indices() -> uint8_t*;
+    auto back_emphasis() -> uint8_t*;
+    auto publish() -> void;
+
+    // The last frame published, still readable by the producer (the presenter
+    // only ever reads it as well), for redrawing from when a frame turns out
+    // to match it
+    auto previous() const -> const uint32_t*;
+    auto previous_indices() const -> const uint8_t*;
+    auto previous_emphasis() const -> const uint8_t*;
+
+    // Consumer (presenter) side
+    auto acquire() -> bool;
+    auto front() const -> const uint32_t*;
+    auto front_indices() const -> const uint8_t*;
+    auto front_emphasis() const -> const uint8_t*;
+
+    auto frames_published() const -> uint64_t;
+    auto frames_dropped() const -> uint64_t;
+
+  private:
+    static const int slot_count = 3;
+
+    // Low two bits of m_ready hold the slot index, this bit marks it as unseen
+    static const uint8_t fresh_bit = 0x04;
+    static const uint8_t index_mask = 0x03;
+
+    pixel_format m_format;
+
+    struct aligned_free
+    {
+        auto operator()(void* memory) const -> void;
+    };
+
+    // One aligned allocation holds all three slots, carved up into the planes
+    // of m_format; the other format's pointers stay null
+    std::unique_ptr<uint8_t, aligned_free> m_storage;
+    std::array<uint32_t*, slot_count> m_slots {};
+    std::array<uint8_t*, slot_count> m_index_slots {};
+    std::array<uint8_t*, slot_count> m_emphasis_slots {};
+
+    uint8_t m_back = 0;
+    uint8_t m_previous = 2;
+    uint8_t m_front = 1;
+    std::atomic<uint8_t> m_ready {2};
+
+    std::atomic<uint64_t> m_published {0};
+    std::atomic<uint64_t> m_dropped {0};
+};
+
+#endif  // CYGNES_FRAME_BUFFER_HPP
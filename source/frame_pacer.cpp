@@ -0,0 +1,126 @@
+#include "frame_pacer.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+frame_pacer::frame_pacer()
+    : m_deadline(clock::now())
+    , m_overshoot(min_spin)
+    , m_spin(min_spin * 2)
+{
+
+}
+
+auto frame_pacer::set_speed(double multiplier) -> void
+{
+    m_speed.store(multiplier, std::memory_order_relaxed);
+}
+
+auto frame_pacer::speed() const -> double
+{
+    return m_speed.load(std::memory_order_relaxed);
+}
+
+auto frame_pacer::restart() -> void
+{
+    m_deadline = clock::now();
+    m_behind = false;
+}
+
+auto frame_pacer::frame_period() const -> clock::duration
+{
+    std::chrono::duration<double> period(1.0 / (ntsc_frame_rate * speed()));
+    return std::chrono::duration_cast<clock::duration>(period);
+}
+
+auto frame_pacer::wait_for_next_frame() -> void
+{
+    auto now = clock::now();
+
+    if (speed() <= unthrottled)
+    {
+        // Keep the schedule anchored to the present, so switching back to a
+        // throttled speed doesn't try to make up for lost time
+        m_deadline = now;
+        m_behind = false;
+        return;
+    }
+
+    m_deadline += frame_period();
+    m_behind = now > m_deadline;
+
+    if (!m_behind)
+    {
+        auto wake_at = m_deadline - m_spin;
+
+        if (now < wake_at)
+        {
+            std::this_thread::sleep_until(wake_at);
+
+            // Leave enough spin time to cover a typical oversleep, with some
+            // margin on top
+            auto overshoot = std::max(clock::now() - wake_at, clock::duration::zero());
+            m_overshoot = (m_overshoot * 7 + overshoot) / 8;
+            m_spin = std::clamp<clock::duration>(m_overshoot * 2, min_spin, max_spin);
+        }
+
+        auto spin_start = clock::now();
+        while (clock::now() < m_deadline)
+        {
+            // Spin out whatever's left
+        }
+
+        now = clock::now();
+        m_spin_sum_us += std::chrono::duration<double, std::micro>(now - spin_start).count();
+    }
+    else
+    {
+        m_stats.late_frames++;
+    }
+
+    double error_us = std::chrono::duration<double, std::micro>(now - m_deadline).count();
+    m_stats.frames++;
+    m_error_sum_us += error_us;
+    m_abs_error_sum_us += error_us < 0 ? -error_us : error_us;
+    m_stats.max_error_us = std::max(m_stats.max_error_us, error_us);
+
+    // Too far gone to catch up without a burst of unpaced frames
+    if (now - m_deadline > frame_period() * max_frames_behind)
+    {
+        m_deadline = now;
+        m_stats.resyncs++;
+    }
+}
+
+auto frame_pacer::behind() const -> bool
+{
+    return m_behind;
+}
+
+auto frame_pacer::stats() const -> pacing_stats
+{
+    pacing_stats stats = m_stats;
+
+    if (stats.frames > 0)
+    {
+        stats.mean_error_us = m_error_sum_us / stats.frames;
+        stats.mean_abs_error_us = m_abs_error_sum_us / stats.frames;
+        stats.mean_spin_us = m_spin_sum_us / stats.frames;
+    }
+
+    return stats;
+}
+
+auto frame_pacer::print_stats() const -> void
+{
+    pacing_stats stats = this->stats();
+
+    printf("Frames paced: \t\t%llu\n", static_cast<unsigned long long>(stats.frames));
+    printf("Late frames: \t\t%llu\n", static_cast<unsigned long long>(stats.late_frames));
+    printf("Resyncs: \t\t%llu\n", static_cast<unsigned long long>(stats.resyncs));
+    printf("Mean error (us): \t%.1f\n", stats.mean_error_us);
+    printf("Mean |error| (us): \t%.1f\n", stats.mean_abs_error_us);
+    printf("Max error (us): \t%.1f\n", stats.max_error_us);
+    printf("Mean spin (us): \t%.1f\n", stats.mean_spin_us);
+}
@@ -0,0 +1,73 @@
+#ifndef CYGNES_FRAME_PACER_HPP
+#define CYGNES_FRAME_PACER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/*
+ * Keeps the emulation running at the NTSC frame rate (or a multiple of it).
+ *
+ * Waiting is done by sleeping until shortly before the deadline and spinning
+ * the rest of the way, since OS sleeps routinely overshoot by a fair chunk of
+ * a millisecond. The spin window adapts to how badly sleeps have been
+ * overshooting, so an idle emulator doesn't burn a whole core.
+ */
+class frame_pacer
+{
+  public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr double ntsc_frame_rate = 60.0988;
+    static constexpr double unthrottled = 0.0;
+
+    struct pacing_stats
+    {
+        uint64_t frames = 0;
+        uint64_t late_frames = 0;
+        uint64_t resyncs = 0;
+
+        // How far past its deadline each frame was released (negative = early)
+        double mean_error_us = 0.0;
+        double mean_abs_error_us = 0.0;
+        double max_error_us = 0.0;
+
+        double mean_spin_us = 0.0;
+    };
+
+    frame_pacer();
+
+    auto set_speed(double multiplier) -> void;
+    auto speed() const -> double;
+
+    auto restart() -> void;
+    auto wait_for_next_frame() -> void;
+    auto behind() const -> bool;
+
+    auto stats() const -> pacing_stats;
+    auto print_stats() const -> void;
+
+  private:
+    // If we ever fall this many frames behind, stop trying to catch up
+    static constexpr int max_frames_behind = 4;
+
+    static constexpr std::chrono::microseconds min_spin {100};
+    static constexpr std::chrono::microseconds max_spin {2000};
+
+    // Written by the UI thread, read by the emulation thread
+    std::atomic<double> m_speed {1.0};
+
+    clock::time_point m_deadline;
+    clock::duration m_overshoot;
+    clock::duration m_spin;
+    bool m_behind = false;
+
+    pacing_stats m_stats;
+    double m_error_sum_us = 0.0;
+    double m_abs_error_sum_us = 0.0;
+    double m_spin_sum_us = 0.0;
+
+    auto frame_period() const -> clock::duration;
+};
+
+#endif  // CYGNES_FRAME_PACER_HPP
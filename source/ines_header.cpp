@@ -0,0 +1,125 @@
+#include "ines_header.hpp"
+
+#include <cstdio>
+
+namespace
+{
+const uint64_t prg_rom_bank_size = 0x4000;
+const uint64_t chr_rom_bank_size = 0x2000;
+
+// NES 2.0 ROM sizes: a 12-bit bank count, unless the high nibble is all ones,
+// in which case the low byte is 2^exponent * (multiplier * 2 + 1) bytes
+auto rom_size(uint8_t lsb, uint8_t msb, uint64_t bank_size) -> uint64_t
+{
+    uint64_t size = 0;
+
+    if (msb == 0x0F)
+    {
+        int exponent = lsb >> 2;
+        int multiplier = (lsb & 0x03) * 2 + 1;
+        size = exponent < 64 - 3 ? (uint64_t {1} << exponent) * multiplier : UINT64_MAX;
+    }
+    else
+    {
+        size = ((uint64_t {msb} << 8) | lsb) * bank_size;
+    }
+
+    return size;
+}
+
+// NES 2.0 RAM sizes: 64 << count bytes, with 0 meaning none
+auto ram_size(int shift_count) -> int
+{
+    return shift_count == 0 ? 0 : 64 << shift_count;
+}
+}  // namespace
+
+auto ines_header::decode(const uint8_t* bytes) -> bool
+{
+    bool success = bytes[0] == 'N'
+                   and bytes[1] == 'E'
+                   and bytes[2] == 'S'
+                   and bytes[3] == 0x1A;
+
+    if (success)
+    {
+        *this = ines_header();
+
+        nes2 = (bytes[7] & 0x0C) == 0x08;
+
+        vertical_mirroring = (bytes[6] & 0b0001) == 0b0001;
+        has_battery = (bytes[6] & 0b0010) == 0b0010;
+        has_trainer = (bytes[6] & 0b0100) == 0b0100;
+        four_screen = (bytes[6] & 0b1000) == 0b1000;
+
+        mapper = bytes[6] >> 4;
+
+        if (nes2)
+        {
+            mapper |= (bytes[7] & 0xF0) | ((bytes[8] & 0x0F) << 8);
+            submapper = bytes[8] >> 4;
+
+            prg_rom_size = rom_size(bytes[4], bytes[9] & 0x0F, prg_rom_bank_size);
+            chr_rom_size = rom_size(bytes[5], bytes[9] >> 4, chr_rom_bank_size);
+
+            prg_ram_size = ram_size(bytes[10] & 0x0F);
+            prg_nvram_size = ram_size(bytes[10] >> 4);
+            chr_ram_size = ram_size(bytes[11] & 0x0F);
+            chr_nvram_size = ram_size(bytes[11] >> 4);
+
+            region = static_cast<timing>(bytes[12] & 0x03);
+            type = static_cast<console>(bytes[7] & 0x03);
+            misc_rom_count = bytes[14] & 0x03;
+            expansion_device = bytes[15] & 0x3F;
+        }
+        else
+        {
+            // Old dumping tools wrote their names into bytes 7-15, so byte
+            // 7's mapper bits only count when the padding is clean
+            if (bytes[12] == 0 and bytes[13] == 0 and bytes[14] == 0 and bytes[15] == 0)
+            {
+                mapper |= bytes[7] & 0xF0;
+                type = static_cast<console>(bytes[7] & 0x03);
+                region = (bytes[9] & 0x01) == 0x01 ? timing::pal : timing::ntsc;
+            }
+
+            prg_rom_size = bytes[4] * prg_rom_bank_size;
+            chr_rom_size = bytes[5] * chr_rom_bank_size;
+
+            int prg_ram = (bytes[8] == 0 ? 1 : bytes[8]) * 0x2000;
+            if (has_battery)
+            {
+                prg_nvram_size = prg_ram;
+            }
+            else
+            {
+                prg_ram_size = prg_ram;
+            }
+            chr_ram_size = chr_rom_size == 0 ? 0x2000 : 0;
+        }
+    }
+
+    return success;
+}
+
+auto ines_header::prg_rom_offset() const -> uint64_t
+{
+    return size + (has_trainer ? 512 : 0);
+}
+
+auto ines_header::print() const -> void
+{
+    static const char* timing_names[] = {"NTSC", "PAL", "multiple-region", "Dendy"};
+
+    printf("Header format: \t\t%s\n", nes2 ? "NES 2.0" : "iNES");
+    printf("Mapper: \t\t\t%d.%d\n", mapper, submapper);
+    printf("PRG-ROM Size (bytes): \t%llu\n", static_cast<unsigned long long>(prg_rom_size));
+    printf("CHR-ROM Size (bytes): \t%llu\n", static_cast<unsigned long long>(chr_rom_size));
+    printf("PRG-RAM Size (bytes): \t%d (+%d battery-backed)\n", prg_ram_size, prg_nvram_size);
+    printf("CHR-RAM Size (bytes): \t%d (+%d battery-backed)\n", chr_ram_size, chr_nvram_size);
+    printf("Vertically mapped: \t\t%s\n", vertical_mirroring ? "true" : "false");
+    printf("Battery backup: \t\t%s\n", has_battery ? "true" : "false");
+    printf("Trainer in ROM: \t\t%s\n", has_trainer ? "true" : "false");
+    printf("4 Screen Mode: \t\t%s\n", four_screen ? "true" : "false");
+    printf("Timing: \t\t\t%s\n", timing_names[static_cast<int>(region)]);
+}
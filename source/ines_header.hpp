@@ -0,0 +1,73 @@
+#ifndef CYGNES_INES_HEADER_HPP
+#define CYGNES_INES_HEADER_HPP
+
+#include <cstdint>
+
+/*
+ * The 16-byte header at the start of an iNES or NES 2.0 file, decoded. Sizes
+ * are in bytes, whichever way the file encodes them (NES 2.0 has 12-bit bank
+ * counts, an exponent-multiplier form for odd sizes, and shift counts for
+ * RAM).
+ *
+ * Plain iNES files don't describe RAM, so they get what emulators have always
+ * given them: 8 KB of PRG-RAM (battery-backed if the battery bit is set)
+ * unless byte 8 asks for more, and 8 KB of CHR-RAM when there's no CHR-ROM.
+ */
+class ines_header
+{
+  public:
+    static constexpr int size = 16;
+
+    enum class timing
+    {
+        ntsc,
+        pal,
+        multiple,
+        dendy,
+    };
+
+    enum class console
+    {
+        nes,
+        vs_system,
+        playchoice_10,
+        extended,
+    };
+
+    bool nes2 = false;
+
+    int mapper = 0;
+    int submapper = 0;
+
+    uint64_t prg_rom_size = 0;
+    uint64_t chr_rom_size = 0;
+
+    // Battery-backed ("NV") RAM is counted separately from RAM that's lost
+    // at power-off
+    int prg_ram_size = 0;
+    int prg_nvram_size = 0;
+    int chr_ram_size = 0;
+    int chr_nvram_size = 0;
+
+    bool vertical_mirroring = false;
+    bool four_screen = false;
+    bool has_battery = false;
+    bool has_trainer = false;
+
+    timing region = timing::ntsc;
+    console type = console::nes;
+
+    // NES 2.0 only
+    int misc_rom_count = 0;
+    int expansion_device = 0;
+
+    // False when the bytes don't start with "NES\x1A"
+    auto decode(const uint8_t* bytes) -> bool;
+
+    // Where PRG-ROM starts in the file, past the header and any trainer
+    auto prg_rom_offset() const -> uint64_t;
+
+    auto print() const -> void;
+};
+
+#endif  // CYGNES_INES_HEADER_HPP
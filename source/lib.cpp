@@ -1,23 +1,87 @@
 #include "lib.hpp"
 
+#include <atomic>
+#include <thread>
 #include <utility>
 
+#include "presenter.hpp"
+
 library::library(std::string path)
+    : library(std::move(path), settings())
+{
+
+}
+
+library::library(std::string path, settings options)
     : name("CygNES")
 {
     SDL_Event e;
 
+    presenter display(frame_buffer::width * 2, frame_buffer::height * 2, options.software_surface);
+
+    // The NTSC filter works from palette indices rather than finished colors
+    bool index_frames = options.index_frames or options.ntsc_scale > 0;
+    std::shared_ptr<frame_buffer> frames = std::make_shared<frame_buffer>(
+        index_frames ? frame_buffer::palette_index : frame_buffer::argb);
+    display.connect_frame_buffer(frames);
+
+    if (options.ntsc_scale > 0)
+    {
+        display.enable_ntsc_filter(options.ntsc_scale);
+    }
+    else if (options.upscale)
+    {
+        display.enable_upscaler(options.upscaler_type);
+    }
+    display.clear();
+
     cpu CPU = cpu();
     std::shared_ptr<cartridge> cart = std::make_shared<cartridge>();
     std::shared_ptr<controller> controller_a = std::make_shared<controller>(e);
 
     if (cart->open_rom_file(std::move(path)))
     {
+        if (options.show_header)
+        {
+            cart->header().print();
+        }
+
         CPU.connect_cartridge(cart);
         CPU.connect_controller(controller_a);
+        CPU.connect_frame_buffer(frames);
+        CPU.set_frame_skip(options.frame_skip);
+        CPU.set_pipelined(options.pipelined, options.scanline_workers);
         CPU.reset();
 
-        bool quit = false;
+        std::atomic<bool> quit {false};
+        std::atomic<bool> do_reset {false};
+
+        // The emulation gets a thread to itself, so it never has to wait on
+        // the GPU driver or vsync; it just publishes frames as they finish
+        frame_pacer pacer;
+        pacer.set_speed(options.speed);
+
+        std::thread emulation([&]() {
+            uint64_t last_frame = CPU.frame_count();
+            pacer.restart();
+
+            while (!quit.load(std::memory_order_relaxed))
+            {
+                if (do_reset.exchange(false))
+                {
+                    CPU.reset();
+                }
+
+                CPU.step();
+
+                if (CPU.frame_count() != last_frame)
+                {
+                    last_frame = CPU.frame_count();
+                    pacer.wait_for_next_frame();
+                    CPU.set_behind_schedule(pacer.behind());
+                }
+            }
+        });
 
         while (!quit)
         {
@@ -36,15 +100,22 @@ library::library(std::string path)
                             quit = true;
                             break;
                         case SDLK_r:
-                            CPU.reset();
+                            do_reset = true;
                             break;
                     }
                 }
                 controller_a->get_input();
             }
 
-            CPU.step();
+            if (!display.present())
+            {
+                SDL_Delay(1);
+            }
         }
+
+        emulation.join();
+        pacer.print_stats();
+        printf("Static frames reused: \t%llu\n", static_cast<unsigned long long>(CPU.static_frames()));
     }
 
     SDL_Quit();
@@ -2,7 +2,9 @@
 
 #include <string>
 #include "cpu.hpp"
+#include "frame_pacer.hpp"
 #include "ppu.hpp"
+#include "upscaler.hpp"
 
 /**
  * @brief The core implementation of the executable
@@ -14,10 +16,52 @@
  */
 struct library
 {
+  /**
+   * @brief Options picked on the command line
+   */
+  struct settings
+  {
+    // Frames to skip after each drawn one, or ppu::frame_skip_auto to skip
+    // only while running behind real time
+    int frame_skip = 0;
+
+    // Multiple of the NTSC frame rate to run at, or frame_pacer::unthrottled
+    // to run as fast as possible
+    double speed = 1.0;
+
+    // Draw frames on a second thread from a log of PPU accesses, leaving the
+    // emulation thread with only the PPU's timing to run
+    bool pipelined = false;
+
+    // Extra threads for drawing each pipelined frame in bands of scanlines,
+    // 0 to draw frames top to bottom on the one render thread
+    int scanline_workers = 0;
+
+    // Have the PPU write palette indices instead of ARGB and convert them at
+    // present time (always on with the NTSC filter)
+    bool index_frames = false;
+
+    // Horizontal scale of the NTSC composite filter (2 or 3), 0 for off
+    int ntsc_scale = 0;
+
+    // Software upscaler to run before presenting, if any (ignored when the
+    // NTSC filter is on)
+    bool upscale = false;
+    upscaler::kind upscaler_type = upscaler::nearest_2x;
+
+    // Draw into the window surface with our own scaler instead of through an
+    // SDL renderer, for hosts without a GPU
+    bool software_surface = false;
+
+    // Print the ROM's header once it's loaded
+    bool show_header = false;
+  };
+
   /**
    * @brief Simply initializes the name member to the name of the project
    */
   library(std::string path);
+  library(std::string path, settings options);
 
   std::string name;
 };
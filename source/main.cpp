@@ -1,4 +1,5 @@
 #include <iostream>
+#include <stdexcept>
 #include <string>
 
 #include "lib.hpp"
@@ -7,8 +8,79 @@ auto main(int argc, char* argv[]) -> int
 {
     if (argc > 1)
     {
+        library::settings options;
+
+        for (int arg = 2; arg + 1 < argc; arg += 2)
+        {
+            std::string option = argv[arg];
+            std::string value = argv[arg + 1];
+
+            // Numbers that don't parse are reported like unknown options
+            // and leave the setting as it was
+            try
+            {
+                if (option == "--frame-skip")
+                {
+                    options.frame_skip = value == "auto" ? ppu::frame_skip_auto : std::stoi(value);
+                }
+                else if (option == "--speed")
+                {
+                    options.speed = value == "unthrottled" ? frame_pacer::unthrottled : std::stod(value);
+                }
+                else if (option == "--pipeline")
+                {
+                    options.pipelined = value == "on";
+                }
+                else if (option == "--scanline-workers")
+                {
+                    options.scanline_workers = std::stoi(value);
+                    options.pipelined = options.pipelined or options.scanline_workers > 0;
+                }
+                else if (option == "--frame-format")
+                {
+                    options.index_frames = value == "index";
+                    if (!options.index_frames and value != "argb")
+                    {
+                        std::cout << "Unknown frame format " << value << '\n';
+                    }
+                }
+                else if (option == "--ntsc")
+                {
+                    options.ntsc_scale = std::stoi(value);
+                }
+                else if (option == "--upscale")
+                {
+                    options.upscale = upscaler::from_name(value, options.upscaler_type);
+                    if (!options.upscale)
+                    {
+                        std::cout << "Unknown upscaler " << value << '\n';
+                    }
+                }
+                else if (option == "--present")
+                {
+                    options.software_surface = value == "surface";
+                    if (!options.software_surface and value != "renderer")
+                    {
+                        std::cout << "Unknown presentation mode " << value << '\n';
+                    }
+                }
+                else if (option == "--rom-info")
+                {
+                    options.show_header = value == "on";
+                }
+                else
+                {
+                    std::cout << "Unknown option " << option << '\n';
+                }
+            }
+            catch (const std::logic_error&)
+            {
+                std::cout << "Bad value " << value << " for " << option << '\n';
+            }
+        }
+
         printf("rom path: %s\n", argv[1]);
-        library lib(argv[1]);
+        library lib(argv[1], options);
 //        std::string message = "Hello from " + lib.name + "!";
 //        std::cout << message << '\n';
     }
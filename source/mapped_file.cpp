@@ -0,0 +1,80 @@
+#include "mapped_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility>
+
+mapped_file::~mapped_file()
+{
+    close();
+}
+
+mapped_file::mapped_file(mapped_file&& other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr))
+    , m_size(std::exchange(other.m_size, 0))
+{
+
+}
+
+auto mapped_file::operator=(mapped_file&& other) noexcept -> mapped_file&
+{
+    if (this != &other)
+    {
+        close();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+    }
+
+    return *this;
+}
+
+auto mapped_file::open(const std::string& path) -> bool
+{
+    bool success = false;
+
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        struct stat info = {};
+        if (fstat(fd, &info) == 0 and info.st_size > 0)
+        {
+            void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                m_data = data;
+                m_size = static_cast<size_t>(info.st_size);
+                success = true;
+            }
+        }
+
+        // The mapping holds its own reference to the file
+        ::close(fd);
+    }
+
+    return success;
+}
+
+auto mapped_file::close() -> void
+{
+    if (m_data != nullptr)
+    {
+        munmap(m_data, m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+}
+
+auto mapped_file::data() const -> const uint8_t*
+{
+    return static_cast<const uint8_t*>(m_data);
+}
+
+auto mapped_file::size() const -> size_t
+{
+    return m_size;
+}
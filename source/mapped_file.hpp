@@ -0,0 +1,39 @@
+#ifndef CYGNES_MAPPED_FILE_HPP
+#define CYGNES_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * A whole file mapped read-only into memory. The pages come straight from the
+ * OS's file cache and are shared by every process (and every cartridge) that
+ * maps the same file, so opening one costs next to nothing and nothing is
+ * copied until something is actually read.
+ */
+class mapped_file
+{
+    void* m_data = nullptr;
+    size_t m_size = 0;
+
+  public:
+    mapped_file() = default;
+    ~mapped_file();
+
+    mapped_file(const mapped_file&) = delete;
+    auto operator=(const mapped_file&) -> mapped_file& = delete;
+
+    // Moving keeps the mapping where it is, so pointers into it stay good
+    mapped_file(mapped_file&& other) noexcept;
+    auto operator=(mapped_file&& other) noexcept -> mapped_file&;
+
+    // Drops whatever was mapped before. Fails on files that can't be opened
+    // or are empty.
+    auto open(const std::string& path) -> bool;
+    auto close() -> void;
+
+    auto data() const -> const uint8_t*;
+    auto size() const -> size_t;
+};
+
+#endif  // CYGNES_MAPPED_FILE_HPP
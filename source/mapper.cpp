@@ -3,8 +3,84 @@
 //
 
 #include "mapper.hpp"
-mapper::mapper(int prg_banks, int chr_banks)
+
+#include <atomic>
+
+namespace
+{
+// What windows show before a ROM is loaded
+uint8_t unmapped[mapper::prg_window_size] = {};
+
+// The last generation any mapper took
+std::atomic<uint32_t> last_generation {0};
+}  // namespace
+
+mapper::mapper(const memory& rom)
+    : m_rom(rom)
+{
+    prg_banks = rom.prg_size / 0x4000;
+    chr_banks = rom.chr_ram ? 0 : rom.chr_size / 0x2000;
+
+    m_prg_windows.fill(unmapped);
+    m_chr_windows.fill(unmapped);
+
+    uint32_t generation = next_generation();
+    m_prg_generations.fill(generation);
+    m_chr_generations.fill(generation);
+
+    set_mirroring(rom.vertical_mirroring ? mirroring::vertical : mirroring::horizontal);
+}
+
+auto mapper::map_prg(int window, int offset) -> void
+{
+    if (m_rom.prg_size > 0)
+    {
+        const uint8_t* bank = m_rom.prg + offset % m_rom.prg_size;
+        if (m_prg_windows[window] != bank)
+        {
+            m_prg_windows[window] = bank;
+            m_prg_generations[window] = next_generation();
+        }
+    }
+}
+
+auto mapper::map_chr(int window, int offset) -> void
+{
+    if (m_rom.chr_size > 0)
+    {
+        const uint8_t* bank = m_rom.chr + offset % m_rom.chr_size;
+        if (m_chr_windows[window] != bank)
+        {
+            m_chr_windows[window] = bank;
+            m_chr_generations[window] = next_generation();
+            m_ppu_generation++;
+        }
+    }
+}
+
+auto mapper::next_generation() -> uint32_t
+{
+    m_generation = last_generation.fetch_add(1, std::memory_order_relaxed) + 1;
+    return m_generation;
+}
+
+auto mapper::set_mirroring(mirroring arrangement) -> void
+{
+    static const std::array<uint16_t, 4> pages[] = {
+        {0x000, 0x000, 0x400, 0x400},
+        {0x000, 0x400, 0x000, 0x400},
+        {0x000, 0x000, 0x000, 0x000},
+        {0x400, 0x400, 0x400, 0x400},
+    };
+
+    if (pages[static_cast<int>(arrangement)] != m_nametables)
+    {
+        m_nametables = pages[static_cast<int>(arrangement)];
+        m_ppu_generation++;
+    }
+}
+
+auto mapper::set_prg_ram_enabled(bool enabled) -> void
 {
-    this->prg_banks = prg_banks;
-    this->chr_banks = chr_banks;
+    m_prg_ram_enabled = enabled;
 }
@@ -5,19 +5,219 @@
 #ifndef CYGNES_MAPPER_HPP
 #define CYGNES_MAPPER_HPP
 
+#include <array>
 #include <cstdint>
 
+/*
+ * What every mapper has in common. The mappers are a closed set that the
+ * cartridge holds by value in a std::variant, so nothing here is virtual.
+ *
+ * Reads don't go through the mapper at all: it keeps a table of host
+ * pointers for the CPU's four 8 KB windows at $8000-$FFFF and the PPU's eight
+ * 1 KB windows at $0000-$1FFF, and the CPU and PPU index those directly. A
+ * mapper only runs code when a bank register is written, and then just
+ * repoints the windows it switched with map_prg() and map_chr(). Nametable
+ * mirroring and the PRG-RAM enable work the same way.
+ *
+ * The PPU can't see CHR banks or mirroring change, so ppu_generation()
+ * moves whenever either does, for the CPU to tell the PPU its frame is stale.
+ * Finer-grained, each window has a generation that changes when it's pointed
+ * somewhere else or, for CHR-RAM, written through (by way of any window
+ * showing the same page), so anything decoded from
+ * what a window shows can be checked with one compare. Window generations
+ * are stamped from one counter shared by every mapper in the process, so a
+ * cache kept across a ROM change can't mistake a new mapper's windows for
+ * an old one's; generation() is the last stamp this mapper took, and never
+ * behind any of its windows.
+ *
+ * A mapper that raises IRQs holds irq() high until the game acknowledges it;
+ * the CPU samples it between instructions. One that counts scanlines hides
+ * scanline() with its own, which the PPU calls once per rendered line.
+ *
+ * Every mapper has:
+ *   a constructor taking the cartridge's memory, which maps its power-on
+ *   banks
+ *   cpu_write(addr, byte) for $8000-$FFFF, which latches bank registers;
+ *   writes never reach PRG-ROM
+ */
 class mapper
 {
+  public:
+    static constexpr int prg_window_size = 0x2000;
+    static constexpr int chr_window_size = 0x0400;
+    static constexpr int prg_window_count = 4;
+    static constexpr int chr_window_count = 8;
+
+    // Where the cartridge keeps PRG and CHR. ROM is a read-only view of the
+    // file; when chr_ram is set, CHR is RAM the cartridge allocated, and the
+    // PPU can write to it.
+    struct memory
+    {
+        const uint8_t* prg;
+        int prg_size;
+        const uint8_t* chr;
+        int chr_size;
+        bool chr_ram;
+        bool vertical_mirroring;
+    };
+
+    // Which 1 KB page of the PPU's 2 KB of VRAM each nametable shows
+    enum class mirroring
+    {
+        horizontal,
+        vertical,
+        single_lower,
+        single_upper,
+    };
+
+    explicit mapper(const memory& rom);
+
+    auto rom() const -> const memory&;
+
+    auto prg_read(uint16_t addr) const -> uint8_t;
+    auto chr_read(uint16_t addr) const -> uint8_t;
+    auto chr_write(uint16_t addr, uint8_t byte) -> bool;
+
+    // Where a $2000-$3EFF address lands in VRAM
+    auto nametable_offset(uint16_t addr) const -> uint16_t;
+
+    // Which 1 KB page of CHR a window shows
+    auto chr_page(int window) const -> int;
+
+    auto prg_ram_enabled() const -> bool;
+    auto ppu_generation() const -> uint32_t;
+
+    auto prg_generation(int window) const -> uint32_t;
+    auto chr_generation(int window) const -> uint32_t;
+    auto generation() const -> uint32_t;
+    auto irq() const -> bool;
+
+    auto scanline() -> void;
+
   protected:
-    int prg_banks, chr_banks;
+    // In 16 KB and 8 KB units, as the iNES header counts them; chr_banks is
+    // 0 for CHR-RAM
+    int prg_banks;
+    int chr_banks;
 
-  public:
-    mapper(int prg_banks, int chr_banks);
-    virtual auto cpu_read(uint16_t addr, int& mapped_addr) -> bool = 0;
-    virtual auto cpu_write(uint16_t addr, int& mapped_addr) -> bool = 0;
-    virtual auto ppu_read(uint16_t addr, int& mapped_addr) -> bool = 0;
-    virtual auto ppu_write(uint16_t addr, int& mapped_addr) -> bool = 0;
+    // Point a window at offset bytes into PRG or CHR, wrapping offsets past
+    // the end the way a mapper's unconnected bank bits would
+    auto map_prg(int window, int offset) -> void;
+    auto map_chr(int window, int offset) -> void;
+
+    auto set_mirroring(mirroring arrangement) -> void;
+    auto set_prg_ram_enabled(bool enabled) -> void;
+    auto set_irq(bool asserted) -> void;
+
+  private:
+    auto next_generation() -> uint32_t;
+
+    memory m_rom;
+
+    std::array<const uint8_t*, prg_window_count> m_prg_windows;
+    std::array<const uint8_t*, chr_window_count> m_chr_windows;
+    std::array<uint32_t, prg_window_count> m_prg_generations = {};
+    std::array<uint32_t, chr_window_count> m_chr_generations = {};
+    uint32_t m_generation = 0;
+    std::array<uint16_t, 4> m_nametables = {};
+    bool m_prg_ram_enabled = true;
+    bool m_irq = false;
+    uint32_t m_ppu_generation = 0;
 };
 
+inline auto mapper::rom() const -> const memory&
+{
+    return m_rom;
+}
+
+inline auto mapper::prg_read(uint16_t addr) const -> uint8_t
+{
+    return m_prg_windows[(addr >> 13) & 0x03][addr & (prg_window_size - 1)];
+}
+
+inline auto mapper::chr_read(uint16_t addr) const -> uint8_t
+{
+    return m_chr_windows[(addr >> 10) & 0x07][addr & (chr_window_size - 1)];
+}
+
+inline auto mapper::nametable_offset(uint16_t addr) const -> uint16_t
+{
+    return m_nametables[(addr >> 10) & 0x03] | (addr & 0x03FF);
+}
+
+inline auto mapper::chr_page(int window) const -> int
+{
+    return m_rom.chr_size > 0 ? static_cast<int>(m_chr_windows[window] - m_rom.chr) / chr_window_size : 0;
+}
+
+inline auto mapper::prg_ram_enabled() const -> bool
+{
+    return m_prg_ram_enabled;
+}
+
+inline auto mapper::ppu_generation() const -> uint32_t
+{
+    return m_ppu_generation;
+}
+
+inline auto mapper::prg_generation(int window) const -> uint32_t
+{
+    return m_prg_generations[window];
+}
+
+inline auto mapper::chr_generation(int window) const -> uint32_t
+{
+    return m_chr_generations[window];
+}
+
+inline auto mapper::generation() const -> uint32_t
+{
+    return m_generation;
+}
+
+inline auto mapper::irq() const -> bool
+{
+    return m_irq;
+}
+
+inline auto mapper::scanline() -> void
+{
+}
+
+inline auto mapper::set_irq(bool asserted) -> void
+{
+    m_irq = asserted;
+}
+
+inline auto mapper::chr_write(uint16_t addr, uint8_t byte) -> bool
+{
+    bool success = false;
+
+    // CHR-RAM is only const here because CHR-ROM shares the windows
+    if (m_rom.chr_ram)
+    {
+        const uint8_t* written = m_chr_windows[(addr >> 10) & 0x07] + (addr & (chr_window_size - 1));
+
+        if (*written != byte)
+        {
+            *const_cast<uint8_t*>(written) = byte;
+
+            // Any other window showing the same page sees the write too:
+            // MMC1's 4 KB banks set alike, or CHR-RAM smaller than the
+            // windows it's mirrored into
+            uint32_t generation = next_generation();
+            for (int window = 0; window < chr_window_count; ++window)
+            {
+                if (written >= m_chr_windows[window] and written < m_chr_windows[window] + chr_window_size)
+                {
+                    m_chr_generations[window] = generation;
+                }
+            }
+        }
+        success = true;
+    }
+
+    return success;
+}
+
 #endif  // CYGNES_MAPPER_HPP
@@ -3,56 +3,15 @@
 //
 
 #include "mapper000.hpp"
-mapper000::mapper000(int prg_banks, int chr_banks)
-    : mapper(prg_banks, chr_banks)
+mapper000::mapper000(const memory& rom)
+    : mapper(rom)
 {
-
-}
-
-auto mapper000::cpu_read(uint16_t addr, int& mapped_addr) -> bool
-{
-    bool success = false;
-
-    if (addr >= 0x8000 and addr <= 0xFFFF)
+    for (int window = 0; window < prg_window_count; ++window)
     {
-        if (prg_banks == 1)
-        {
-            mapped_addr = (addr & 0x3FFF);
-        }
-        else
-        {
-            mapped_addr = (addr & 0x7FFF);
-        }
-
-        success = true;
+        map_prg(window, window * prg_window_size);
     }
-
-    return success;
-}
-
-auto mapper000::cpu_write(uint16_t addr, int& mapped_addr) -> bool
-{
-    bool success = false;
-
-    return success;
-}
-
-auto mapper000::ppu_read(uint16_t addr, int& mapped_addr) -> bool
-{
-    bool success = false;
-
-    if (addr >= 0x0000 and addr <= 0x1FFF)
+    for (int window = 0; window < chr_window_count; ++window)
     {
-        mapped_addr = addr;
-        success = true;
+        map_chr(window, window * chr_window_size);
     }
-
-    return success;
-}
-
-auto mapper000::ppu_write(uint16_t addr, int& mapped_addr) -> bool
-{
-    bool success = false;
-
-    return success;
 }
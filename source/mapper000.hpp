@@ -7,14 +7,20 @@
 
 #include "mapper.hpp"
 
+/*
+ * NROM: 16 or 32 KB of PRG (16 KB mirrored into both halves) and 8 KB of CHR,
+ * none of it switchable.
+ */
 class mapper000 : public mapper
 {
   public:
-    mapper000(int prg_banks, int chr_banks);
-    auto cpu_read(uint16_t addr, int& mapped_addr) -> bool override;
-    auto cpu_write(uint16_t addr, int& mapped_addr) -> bool override;
-    auto ppu_read(uint16_t addr, int& mapped_addr) -> bool override;
-    auto ppu_write(uint16_t addr, int& mapped_addr) -> bool override;
+    explicit mapper000(const memory& rom);
+    auto cpu_write(uint16_t addr, uint8_t byte) -> void;
 };
 
+inline auto mapper000::cpu_write(uint16_t /*addr*/, uint8_t /*byte*/) -> void
+{
+
+}
+
 #endif  // CYGNES_MAPPER000_HPP
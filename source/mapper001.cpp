@@ -0,0 +1,86 @@
+#include "mapper001.hpp"
+
+mapper001::mapper001(const memory& rom)
+    : mapper(rom)
+{
+    update_banks();
+}
+
+auto mapper001::load_register(uint16_t addr, uint8_t value) -> void
+{
+    uint8_t* target = nullptr;
+
+    switch (addr & 0xE000)
+    {
+        case 0x8000:
+            target = &m_control;
+            break;
+        case 0xA000:
+            target = &m_chr_bank_0;
+            break;
+        case 0xC000:
+            target = &m_chr_bank_1;
+            break;
+        default:
+            target = &m_prg_bank;
+            break;
+    }
+
+    if (*target != value)
+    {
+        *target = value;
+        update_banks();
+    }
+}
+
+auto mapper001::update_banks() -> void
+{
+    static const mirroring arrangements[] = {
+        mirroring::single_lower,
+        mirroring::single_upper,
+        mirroring::vertical,
+        mirroring::horizontal,
+    };
+
+    set_mirroring(arrangements[m_control & 0x03]);
+
+    // 16 KB banks; the outer bit only exists on 512 KB boards
+    int outer = prg_banks > 16 ? (m_chr_bank_0 & 0x10) : 0;
+    int bank = (m_prg_bank & 0x0F) | outer;
+    int low_bank = 0;
+    int high_bank = 0;
+
+    switch ((m_control >> 2) & 0x03)
+    {
+        case 0:
+        case 1:
+            low_bank = bank & ~1;
+            high_bank = low_bank + 1;
+            break;
+        case 2:
+            low_bank = outer;
+            high_bank = bank;
+            break;
+        case 3:
+            low_bank = bank;
+            high_bank = 0x0F | outer;
+            break;
+    }
+
+    map_prg(0, low_bank * 0x4000);
+    map_prg(1, low_bank * 0x4000 + prg_window_size);
+    map_prg(2, high_bank * 0x4000);
+    map_prg(3, high_bank * 0x4000 + prg_window_size);
+
+    // 4 KB banks, or 8 KB ones (low bit ignored) picked by the first
+    int chr_low = (m_control & 0x10) == 0x10 ? m_chr_bank_0 : m_chr_bank_0 & ~1;
+    int chr_high = (m_control & 0x10) == 0x10 ? m_chr_bank_1 : chr_low + 1;
+
+    for (int window = 0; window < 4; ++window)
+    {
+        map_chr(window, chr_low * 0x1000 + window * chr_window_size);
+        map_chr(window + 4, chr_high * 0x1000 + window * chr_window_size);
+    }
+
+    set_prg_ram_enabled((m_prg_bank & 0x10) == 0);
+}
@@ -0,0 +1,60 @@
+#ifndef CYGNES_MAPPER001_HPP
+#define CYGNES_MAPPER001_HPP
+
+#include "mapper.hpp"
+
+/*
+ * MMC1 (SxROM). Registers are loaded a bit at a time: five writes anywhere in
+ * $8000-$FFFF shift bit 0 in, and the fifth lands the value in the register
+ * picked by that write's address ($8000 control, $A000 and $C000 CHR banks,
+ * $E000 PRG bank and RAM enable). A write with bit 7 set resets the shift
+ * and locks the last PRG bank in at $C000.
+ *
+ * Control is mirroring (bits 0-1), PRG mode (2-3: 32 KB, or 16 KB with the
+ * first or last bank fixed) and CHR mode (4: one 8 KB bank or two 4 KB ones).
+ * On 512 KB boards (SUROM) bit 4 of the CHR bank picks the 256 KB half of PRG.
+ *
+ * The four writes that only shift are a couple of instructions each; banks
+ * are only worked out again when a register actually changes.
+ */
+class mapper001 : public mapper
+{
+    // The sentinel bit reaches bit 0 after four writes, which makes the
+    // fifth the one that completes a register
+    static constexpr uint8_t shift_reset = 0x10;
+
+    uint8_t m_shift = shift_reset;
+    uint8_t m_control = 0x0C;
+    uint8_t m_chr_bank_0 = 0;
+    uint8_t m_chr_bank_1 = 0;
+    uint8_t m_prg_bank = 0;
+
+    auto load_register(uint16_t addr, uint8_t value) -> void;
+    auto update_banks() -> void;
+
+  public:
+    explicit mapper001(const memory& rom);
+    auto cpu_write(uint16_t addr, uint8_t byte) -> void;
+};
+
+inline auto mapper001::cpu_write(uint16_t addr, uint8_t byte) -> void
+{
+    if ((byte & 0x80) == 0x80)
+    {
+        m_shift = shift_reset;
+        load_register(0x8000, m_control | 0x0C);
+    }
+    else
+    {
+        bool complete = (m_shift & 1) == 1;
+        m_shift = static_cast<uint8_t>((m_shift >> 1) | ((byte & 1) << 4));
+
+        if (complete)
+        {
+            load_register(addr, m_shift);
+            m_shift = shift_reset;
+        }
+    }
+}
+
+#endif  // CYGNES_MAPPER001_HPP
@@ -0,0 +1,82 @@
+#include "mapper004.hpp"
+
+mapper004::mapper004(const memory& rom)
+    : mapper(rom)
+{
+    update_banks();
+}
+
+auto mapper004::cpu_write(uint16_t addr, uint8_t byte) -> void
+{
+    bool odd = (addr & 1) == 1;
+
+    switch (addr & 0xE000)
+    {
+        case 0x8000:
+            if (!odd)
+            {
+                // Only the layout bits move any windows
+                bool relayout = ((m_bank_select ^ byte) & 0xC0) != 0;
+                m_bank_select = byte;
+                if (relayout)
+                {
+                    update_banks();
+                }
+            }
+            else if (m_registers[m_bank_select & 0x07] != byte)
+            {
+                m_registers[m_bank_select & 0x07] = byte;
+                update_banks();
+            }
+            break;
+        case 0xA000:
+            if (!odd)
+            {
+                set_mirroring((byte & 1) == 1 ? mirroring::horizontal : mirroring::vertical);
+            }
+            break;
+        case 0xC000:
+            if (!odd)
+            {
+                m_irq_latch = byte;
+            }
+            else
+            {
+                m_irq_counter = 0;
+                m_irq_reload = true;
+            }
+            break;
+        case 0xE000:
+            m_irq_enabled = odd;
+            if (!odd)
+            {
+                set_irq(false);
+            }
+            break;
+    }
+}
+
+auto mapper004::update_banks() -> void
+{
+    // 8 KB PRG banks; the last two are the fixed ones
+    int last = prg_banks * 2 - 1;
+    int swapped = (m_bank_select & 0x40) == 0x40 ? 2 : 0;
+
+    map_prg(0 ^ swapped, m_registers[6] * prg_window_size);
+    map_prg(1, m_registers[7] * prg_window_size);
+    map_prg(2 ^ swapped, (last - 1) * prg_window_size);
+    map_prg(3, last * prg_window_size);
+
+    // 1 KB CHR windows; inversion swaps the pattern table halves
+    int inverted = (m_bank_select & 0x80) == 0x80 ? 4 : 0;
+
+    map_chr(0 ^ inverted, (m_registers[0] & 0xFE) * chr_window_size);
+    map_chr(1 ^ inverted, (m_registers[0] | 0x01) * chr_window_size);
+    map_chr(2 ^ inverted, (m_registers[1] & 0xFE) * chr_window_size);
+    map_chr(3 ^ inverted, (m_registers[1] | 0x01) * chr_window_size);
+
+    for (int window = 4; window < chr_window_count; ++window)
+    {
+        map_chr(window ^ inverted, m_registers[window - 2] * chr_window_size);
+    }
+}
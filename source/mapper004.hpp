@@ -0,0 +1,66 @@
+#ifndef CYGNES_MAPPER004_HPP
+#define CYGNES_MAPPER004_HPP
+
+#include <array>
+
+#include "mapper.hpp"
+
+/*
+ * MMC3 (TxROM). Registers sit in pairs on even and odd addresses of each 8 KB
+ * of $8000-$FFFF:
+ *   $8000 which of the eight bank registers $8001 writes, plus the PRG and CHR
+ *         layouts
+ *   $A000 mirroring
+ *   $C000 the IRQ counter's reload value, and $C001 to reload it
+ *   $E000 IRQ off (and acknowledge), $E001 IRQ on
+ *
+ * R0 and R1 are 2 KB CHR banks and R2-R5 1 KB ones, in the low or (inverted)
+ * high half of the pattern tables. R6 and R7 are 8 KB PRG banks at $8000 and
+ * $A000, with the second-to-last bank at $C000; in the other PRG layout R6
+ * and that fixed bank trade places. The last bank is always at $E000.
+ *
+ * The real counter clocks on rising edges of PPU address line A12. Here the
+ * PPU calls scanline() on the dot its fetch schedule would make that edge, so
+ * nothing watches the bus: the counter reloads when it's zero (or a reload
+ * was asked for) and otherwise counts down, and IRQs when it lands on zero.
+ *
+ * $A001's PRG-RAM protect bits are left alone, as MMC6 boards share this
+ * mapper number and use them differently.
+ */
+class mapper004 : public mapper
+{
+    uint8_t m_bank_select = 0;
+    std::array<uint8_t, 8> m_registers = {0, 2, 4, 5, 6, 7, 0, 1};
+
+    uint8_t m_irq_latch = 0;
+    uint8_t m_irq_counter = 0;
+    bool m_irq_reload = false;
+    bool m_irq_enabled = false;
+
+    auto update_banks() -> void;
+
+  public:
+    explicit mapper004(const memory& rom);
+    auto cpu_write(uint16_t addr, uint8_t byte) -> void;
+    auto scanline() -> void;
+};
+
+inline auto mapper004::scanline() -> void
+{
+    if (m_irq_counter == 0 or m_irq_reload)
+    {
+        m_irq_counter = m_irq_latch;
+        m_irq_reload = false;
+    }
+    else
+    {
+        m_irq_counter--;
+    }
+
+    if (m_irq_counter == 0 and m_irq_enabled)
+    {
+        set_irq(true);
+    }
+}
+
+#endif  // CYGNES_MAPPER004_HPP
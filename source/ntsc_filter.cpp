@@ -0,0 +1,291 @@
+#include "ntsc_filter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__GNUC__) and (defined(__x86_64__) or defined(__i386__))
+#include <immintrin.h>
+#define CYGNES_NTSC_AVX2 1
+#endif
+
+namespace
+{
+    // Composite voltages relative to sync, from the nesdev wiki's NTSC video page
+    const float signal_levels[8] = {
+        0.350f, 0.518f, 0.962f, 1.550f,  // low half of the color cycle
+        1.094f, 1.506f, 1.962f, 1.962f   // high half
+    };
+    const float black_level = 0.518f;
+    const float white_level = 1.962f;
+    const float emphasis_attenuation = 0.746f;
+
+    // Shift (in samples) that lines the demodulated hues up with the usual
+    // 2C02 palette
+    const float hue_offset = 4.0f;
+
+    const float pi = 3.14159265358979f;
+
+    // FCC YIQ -> RGB
+    const float i_to_r = 0.946882f, q_to_r = 0.623557f;
+    const float i_to_g = -0.274788f, q_to_g = -0.635691f;
+    const float i_to_b = -1.108545f, q_to_b = 1.709007f;
+
+    auto to_channel(float level) -> uint32_t
+    {
+        return static_cast<uint32_t>(std::min(std::max(level * 255.0f, 0.0f), 255.0f));
+    }
+
+    auto decode_row_scalar(const float* sum_y,
+                           const float* sum_i,
+                           const float* sum_q,
+                           const int32_t* starts,
+                           int first,
+                           int width,
+                           int window,
+                           uint32_t* out) -> void
+    {
+        for (int column = first; column < width; ++column)
+        {
+            int a = starts[column];
+            int b = a + window;
+
+            float y = sum_y[b] - sum_y[a];
+            float i = sum_i[b] - sum_i[a];
+            float q = sum_q[b] - sum_q[a];
+
+            out[column] = 0xFF000000
+                | (to_channel(y + i_to_r * i + q_to_r * q) << 16)
+                | (to_channel(y + i_to_g * i + q_to_g * q) << 8)
+                | to_channel(y + i_to_b * i + q_to_b * q);
+        }
+    }
+
+#ifdef CYGNES_NTSC_AVX2
+    __attribute__((target("avx2"))) auto to_channels(__m256 y, __m256 i, __m256 q, float i_weight, float q_weight) -> __m256i
+    {
+        __m256 level = _mm256_add_ps(y, _mm256_add_ps(_mm256_mul_ps(i, _mm256_set1_ps(i_weight)),
+                                                      _mm256_mul_ps(q, _mm256_set1_ps(q_weight))));
+        level = _mm256_mul_ps(level, _mm256_set1_ps(255.0f));
+        level = _mm256_min_ps(_mm256_max_ps(level, _mm256_setzero_ps()), _mm256_set1_ps(255.0f));
+        return _mm256_cvttps_epi32(level);
+    }
+
+    __attribute__((target("avx2"))) auto decode_row_avx2(const float* sum_y,
+                                                         const float* sum_i,
+                                                         const float* sum_q,
+                                                         const int32_t* starts,
+                                                         int width,
+                                                         int window,
+                                                         uint32_t* out) -> void
+    {
+        const __m256i offset = _mm256_set1_epi32(window);
+        const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+        int column = 0;
+        for (; column + 8 <= width; column += 8)
+        {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(starts + column));
+            __m256i b = _mm256_add_epi32(a, offset);
+
+            __m256 y = _mm256_sub_ps(_mm256_i32gather_ps(sum_y, b, 4), _mm256_i32gather_ps(sum_y, a, 4));
+            __m256 i = _mm256_sub_ps(_mm256_i32gather_ps(sum_i, b, 4), _mm256_i32gather_ps(sum_i, a, 4));
+            __m256 q = _mm256_sub_ps(_mm256_i32gather_ps(sum_q, b, 4), _mm256_i32gather_ps(sum_q, a, 4));
+
+            __m256i r = to_channels(y, i, q, i_to_r, q_to_r);
+            __m256i g = to_channels(y, i, q, i_to_g, q_to_g);
+            __m256i bl = to_channels(y, i, q, i_to_b, q_to_b);
+
+            __m256i argb = _mm256_or_si256(alpha, _mm256_slli_epi32(r, 16));
+            argb = _mm256_or_si256(argb, _mm256_slli_epi32(g, 8));
+            argb = _mm256_or_si256(argb, bl);
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + column), argb);
+        }
+
+        decode_row_scalar(sum_y, sum_i, sum_q, starts, column, width, window, out);
+    }
+
+    const bool has_avx2 = __builtin_cpu_supports("avx2");
+#endif
+}
+
+ntsc_filter::ntsc_filter(int scale, thread_pool& pool)
+    : m_scale(std::min(std::max(scale, 2), 3))
+    , m_width(frame_buffer::width * m_scale)
+    , m_pool(pool)
+{
+    build_tables();
+
+    // Center a 12-sample window on each output column
+    m_window_start.resize(m_width);
+    for (int column = 0; column < m_width; ++column)
+    {
+        m_window_start[column] = ((2 * column + 1) * samples_per_line) / (2 * m_width);
+    }
+}
+
+auto ntsc_filter::width() const -> int
+{
+    return m_width;
+}
+
+auto ntsc_filter::height() const -> int
+{
+    return frame_buffer::height;
+}
+
+auto ntsc_filter::build_tables() -> void
+{
+    m_y_table.assign(index_count * table_stride, 0.0f);
+    m_i_table.assign(index_count * table_stride, 0.0f);
+    m_q_table.assign(index_count * table_stride, 0.0f);
+
+    for (int index = 0; index < index_count; ++index)
+    {
+        int color = index & 0x0F;
+        int level = (index >> 4) & 0x03;
+        int emphasis = index >> 6;
+
+        // Columns $E/$F are always the darker level
+        if (color > 13)
+        {
+            level = 1;
+        }
+
+        float low = signal_levels[level];
+        float high = signal_levels[4 + level];
+
+        // Column 0 is all high (grays/white), columns $D-$F all low (blacks)
+        if (color == 0)
+        {
+            low = high;
+        }
+        if (color > 12)
+        {
+            high = low;
+        }
+
+        for (int start = 0; start < start_phases; ++start)
+        {
+            float total_y = 0.0f;
+            float total_i = 0.0f;
+            float total_q = 0.0f;
+
+            for (int sample = 0; sample < samples_per_pixel; ++sample)
+            {
+                int phase = (start * 4 + sample) % phases;
+                auto in_color_phase = [&](int hue) { return (hue + phase) % phases < 6; };
+
+                float signal = in_color_phase(color) ? high : low;
+
+                if (((emphasis & 0b001) and in_color_phase(0))
+                    or ((emphasis & 0b010) and in_color_phase(4))
+                    or ((emphasis & 0b100) and in_color_phase(8)))
+                {
+                    signal *= emphasis_attenuation;
+                }
+
+                signal = (signal - black_level) / (white_level - black_level) / window;
+
+                float angle = pi * (phase + hue_offset) / 6.0f;
+                total_y += signal;
+                total_i += signal * std::cos(angle);
+                total_q += signal * std::sin(angle);
+
+                int slot = index * table_stride + start * samples_per_pixel + sample;
+                m_y_table[slot] = total_y;
+                m_i_table[slot] = total_i;
+                m_q_table[slot] = total_q;
+            }
+        }
+    }
+}
+
+auto ntsc_filter::apply(const uint8_t* indices, const uint8_t* emphasis, uint32_t* out, int pitch) -> void
+{
+    int frame_phase = m_frame_phase;
+
+    m_pool.parallel_for(0, frame_buffer::height, [&](int first, int last) {
+        filter_lines(indices, emphasis, out, pitch, first, last, frame_phase);
+    });
+
+    // With rendering on, the color phase at the top of the frame flips
+    // between two values on alternate frames
+    m_frame_phase = m_frame_phase == 0 ? 4 : 0;
+}
+
+auto ntsc_filter::filter_lines(const uint8_t* indices, const uint8_t* emphasis, uint32_t* out, int pitch, int first, int last, int frame_phase) const -> void
+{
+    // Prefix sums of each component, with half a window of blanking either
+    // side of the active picture
+    const int padded = samples_per_line + window;
+    std::array<float, padded + 1> sum_y;
+    std::array<float, padded + 1> sum_i;
+    std::array<float, padded + 1> sum_q;
+
+    for (int line = first; line < last; ++line)
+    {
+        // 341 dots x 8 samples per line puts each line 4 samples further
+        // round the color cycle
+        int line_phase = (frame_phase + line * 4) % phases;
+
+        const uint8_t* row = indices + line * frame_buffer::width;
+        int line_emphasis = (emphasis[line] & 0x07) << 6;
+        int n = 0;
+        sum_y[0] = 0.0f;
+        sum_i[0] = 0.0f;
+        sum_q[0] = 0.0f;
+
+        for (; n < window / 2; ++n)
+        {
+            sum_y[n + 1] = sum_y[n];
+            sum_i[n + 1] = sum_i[n];
+            sum_q[n + 1] = sum_q[n];
+        }
+
+        // The tables already hold running totals within a pixel, so each
+        // pixel is 8 independent adds onto the total so far
+        float base_y = sum_y[n];
+        float base_i = sum_i[n];
+        float base_q = sum_q[n];
+
+        for (int x = 0; x < frame_buffer::width; ++x)
+        {
+            int start = (line_phase + x * samples_per_pixel) % phases / 4;
+            int base = (line_emphasis | (row[x] & 0x3F)) * table_stride + start * samples_per_pixel;
+            const float* ty = &m_y_table[base];
+            const float* ti = &m_i_table[base];
+            const float* tq = &m_q_table[base];
+
+            for (int sample = 0; sample < samples_per_pixel; ++sample)
+            {
+                sum_y[n + 1 + sample] = base_y + ty[sample];
+                sum_i[n + 1 + sample] = base_i + ti[sample];
+                sum_q[n + 1 + sample] = base_q + tq[sample];
+            }
+
+            base_y += ty[samples_per_pixel - 1];
+            base_i += ti[samples_per_pixel - 1];
+            base_q += tq[samples_per_pixel - 1];
+            n += samples_per_pixel;
+        }
+
+        for (; n < padded; ++n)
+        {
+            sum_y[n + 1] = sum_y[n];
+            sum_i[n + 1] = sum_i[n];
+            sum_q[n + 1] = sum_q[n];
+        }
+
+        auto out_row = reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(out) + line * pitch);
+
+#ifdef CYGNES_NTSC_AVX2
+        if (has_avx2)
+        {
+            decode_row_avx2(sum_y.data(), sum_i.data(), sum_q.data(), m_window_start.data(), m_width, window, out_row);
+            continue;
+        }
+#endif
+        decode_row_scalar(sum_y.data(), sum_i.data(), sum_q.data(), m_window_start.data(), 0, m_width, window, out_row);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef CYGNES_NTSC_FILTER_HPP
+#define CYGNES_NTSC_FILTER_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "frame_buffer.hpp"
+#include "thread_pool.hpp"
+
+/*
+ * Turns palette-index frames into what a TV would make of the PPU's composite
+ * signal, color fringing and all, at 2x or 3x the horizontal resolution.
+ *
+ * The signal model follows Bisqwit's write-up on the nesdev wiki: each PPU
+ * pixel becomes 8 samples of a square wave with a 12-sample color cycle, and
+ * the TV recovers Y/I/Q by averaging 12 samples around each output pixel.
+ * Since the window is a plain box, every output pixel is just a difference of
+ * two prefix sums, and the YIQ -> RGB step runs 8 pixels at a time with AVX2
+ * when the CPU has it. Scanlines are split into bands across a thread pool.
+ */
+class ntsc_filter
+{
+  public:
+    static const int samples_per_pixel = 8;
+    static const int samples_per_line = frame_buffer::width * samples_per_pixel;
+
+    ntsc_filter(int scale, thread_pool& pool);
+
+    auto width() const -> int;
+    auto height() const -> int;
+
+    // Writes a width() x height() ARGB image from a palette-index frame;
+    // pitch is in bytes
+    auto apply(const uint8_t* indices, const uint8_t* emphasis, uint32_t* out, int pitch) -> void;
+
+  private:
+    static const int phases = 12;
+    static const int window = 12;
+    static const int index_count = 512;
+
+    // A pixel is 8 samples and a line is 4 samples out of step with the last,
+    // so pixels only ever start on phase 0, 4 or 8
+    static const int start_phases = 3;
+    static const int table_stride = start_phases * samples_per_pixel;
+
+    int m_scale;
+    int m_width;
+    thread_pool& m_pool;
+
+    // Per palette index and starting phase, running totals over the pixel's 8
+    // samples of the (normalized) signal level, and of that level multiplied
+    // by the I and Q demodulation carriers
+    std::vector<float> m_y_table;
+    std::vector<float> m_i_table;
+    std::vector<float> m_q_table;
+
+    // First sample of the decode window for each output column
+    std::vector<int32_t> m_window_start;
+
+    // Advances every frame, the same way the PPU's color phase drifts
+    int m_frame_phase = 0;
+
+    auto build_tables() -> void;
+    auto filter_lines(const uint8_t* indices, const uint8_t* emphasis, uint32_t* out, int pitch, int first, int last, int frame_phase) const -> void;
+};
+
+#endif  // CYGNES_NTSC_FILTER_HPP
@@ -0,0 +1,109 @@
+#include "palette.hpp"
+
+#include "frame_buffer.hpp"
+
+namespace
+{
+struct rgb
+{
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+};
+
+constexpr std::array<rgb, palette::color_count> colors = {{
+    // Palette colors from here:
+    // https://www.nesdev.org/wiki/PPU_palettes
+    // Row 1:
+    {84, 84, 84}, {0, 30, 116}, {8, 16, 144}, {48, 0, 136},
+    {68, 0, 100}, {92, 0, 48}, {84, 4, 0}, {60, 24, 0},
+    {32, 42, 0}, {8, 58, 0}, {0, 64, 0}, {0, 60, 0},
+    {0, 50, 60}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0},
+
+    // Row 2:
+    {152, 150, 152}, {8, 76, 196}, {48, 50, 236}, {92, 30, 228},
+    {136, 20, 176}, {160, 20, 100}, {152, 34, 32}, {120, 60, 0},
+    {84, 90, 0}, {40, 114, 0}, {8, 124, 0}, {0, 118, 40},
+    {0, 102, 120}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0},
+
+    // Row 3:
+    {236, 238, 236}, {76, 154, 236}, {120, 124, 236}, {176, 98, 236},
+    {228, 84, 236}, {236, 88, 180}, {236, 106, 100}, {212, 136, 32},
+    {160, 170, 0}, {116, 196, 0}, {76, 208, 32}, {56, 204, 108},
+    {56, 180, 204}, {60, 60, 60}, {0, 0, 0}, {0, 0, 0},
+
+    // Row 4:
+    {236, 238, 236}, {168, 204, 236}, {188, 188, 236}, {212, 178, 236},
+    {236, 174, 236}, {236, 174, 212}, {236, 180, 176}, {228, 196, 144},
+    {204, 210, 120}, {180, 222, 120}, {168, 226, 144}, {152, 226, 180},
+    {160, 214, 228}, {160, 162, 160}, {0, 0, 0}, {0, 0, 0}
+}};
+}  // namespace
+
+auto palette::argb() -> const std::array<uint32_t, index_count>&
+{
+    static const std::array<uint32_t, index_count> table = build_argb();
+    return table;
+}
+
+auto palette::build_argb() -> std::array<uint32_t, index_count>
+{
+    // Each emphasis bit darkens the two channels it doesn't name
+    const double attenuation = 0.816328;
+
+    std::array<uint32_t, index_count> table {};
+
+    for (int emphasis = 0; emphasis < emphasis_count; ++emphasis)
+    {
+        for (int index = 0; index < color_count; ++index)
+        {
+            double r = colors[index].r;
+            double g = colors[index].g;
+            double b = colors[index].b;
+
+            // Columns $E and $F are forced black and ignore emphasis
+            if ((index & 0x0E) != 0x0E)
+            {
+                if (emphasis & 0b001)
+                {
+                    g *= attenuation;
+                    b *= attenuation;
+                }
+                if (emphasis & 0b010)
+                {
+                    r *= attenuation;
+                    b *= attenuation;
+                }
+                if (emphasis & 0b100)
+                {
+                    r *= attenuation;
+                    g *= attenuation;
+                }
+            }
+
+            table[emphasis * color_count + index] = (0xFFu << 24)
+                | (static_cast<uint32_t>(r) << 16)
+                | (static_cast<uint32_t>(g) << 8)
+                | static_cast<uint32_t>(b);
+        }
+    }
+
+    return table;
+}
+
+auto palette::to_argb(const uint8_t* indices, const uint8_t* emphasis, uint32_t* out, int pitch) -> void
+{
+    const uint32_t* table = argb().data();
+
+    for (int line = 0; line < frame_buffer::height; ++line)
+    {
+        const uint32_t* lookup = table + emphasis[line] * color_count;
+        const uint8_t* row = indices + line * frame_buffer::width;
+        uint32_t* dest = reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(out) + line * pitch);
+
+        for (int x = 0; x < frame_buffer::width; ++x)
+        {
+            dest[x] = lookup[row[x]];
+        }
+    }
+}
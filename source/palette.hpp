@@ -0,0 +1,32 @@
+#ifndef CYGNES_PALETTE_HPP
+#define CYGNES_PALETTE_HPP
+
+#include <array>
+#include <cstdint>
+
+/*
+ * The PPU's 64 colors, expanded to ARGB once for each of the 8 combinations of
+ * the $2001 emphasis bits, so a 9-bit palette index (emphasis << 6 | color)
+ * looks up its finished color directly.
+ *
+ * Shared by the PPU, which writes ARGB frames from it, and the presenter,
+ * which converts palette-index frames with it at present time.
+ */
+class palette
+{
+  public:
+    static const int color_count = 0x40;
+    static const int emphasis_count = 8;
+    static const int index_count = color_count * emphasis_count;
+
+    static auto argb() -> const std::array<uint32_t, index_count>&;
+
+    // Expands a palette-index frame (6-bit colors plus the emphasis bits of
+    // each line) to ARGB; pitch is in bytes
+    static auto to_argb(const uint8_t* indices, const uint8_t* emphasis, uint32_t* out, int pitch) -> void;
+
+  private:
+    static auto build_argb() -> std::array<uint32_t, index_count>;
+};
+
+#endif  // CYGNES_PALETTE_HPP
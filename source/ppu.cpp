@@ -2,22 +2,191 @@
 // Created by Noah Schonhorn on 4/2/22.
 //
 
+#include <algorithm>
+#include <cstring>
 #include <cstdint>
 
 #include "ppu.hpp"
+#include "render_pipeline.hpp"
 
-#include "utils.hpp"
+namespace
+{
+// What happens on each dot of each type of line, worked out at compile time
+// from the fetch schedule on the nesdev wiki's PPU timing diagram. Within a
+// dot, clock() runs them in the order the bits are declared, except that
+// vblank is cleared first.
+constexpr auto build_dot_actions() -> std::array<std::array<uint16_t, ppu::dots_per_line>, ppu::line_type_count>
+{
+    std::array<std::array<uint16_t, ppu::dots_per_line>, ppu::line_type_count> table {};
+
+    for (int type : {ppu::visible, ppu::pre})
+    {
+        for (int dot = 0; dot < ppu::dots_per_line; ++dot)
+        {
+            uint16_t actions = 0;
+
+            // Background fetches: 32 tiles for this line, then the first two
+            // of the next, with the shifters running alongside
+            if ((dot >= 2 and dot <= 257) or (dot >= 321 and dot <= 337))
+            {
+                actions |= ppu::shift_bg;
+
+                switch ((dot - 1) % 8)
+                {
+                    case 0:
+                        actions |= ppu::reload_bg | ppu::fetch_nt;
+                        break;
+                    case 2:
+                        actions |= ppu::fetch_at;
+                        break;
+                    case 4:
+                        actions |= ppu::fetch_pattern_low;
+                        break;
+                    case 6:
+                        actions |= ppu::fetch_pattern_high;
+                        break;
+                    case 7:
+                        actions |= ppu::increment_x;
+                        break;
+                }
+
+                if (dot == 256)
+                {
+                    actions |= ppu::increment_y;
+                }
+                if (dot == 257)
+                {
+                    actions |= ppu::reload_bg | ppu::copy_x_bits;
+
+                    // Sprites for line 0 are never shown
+                    if (type == ppu::visible)
+                    {
+                        actions |= ppu::load_sprite_zero;
+                    }
+                }
+            }
+            else if (dot == 338 or dot == 340)
+            {
+                // Unused nametable fetches
+                actions |= ppu::fetch_nt;
+            }
+            else if (type == ppu::pre and dot >= 280 and dot <= 304)
+            {
+                actions |= ppu::copy_y_bits;
+            }
+
+            if (type == ppu::pre and dot == 1)
+            {
+                actions |= ppu::clear_vblank;
+            }
+
+            // Where PPU A12 first rises on a line: the first sprite pattern
+            // fetch, or the next line's first background one (see clock())
+            if (dot == 260 or dot == 324)
+            {
+                actions |= ppu::count_scanline;
+            }
+
+            table[type][dot] = actions;
+        }
+    }
+
+    table[ppu::nmi][1] = ppu::set_vblank;
+
+    // Line 0 is a visible line that starts a dot late
+    table[ppu::first_visible] = table[ppu::visible];
+    table[ppu::first_visible][0] = ppu::skip_dot;
+
+    return table;
+}
+
+constexpr auto build_line_types() -> std::array<uint8_t, ppu::lines_per_frame>
+{
+    std::array<uint8_t, ppu::lines_per_frame> types {};
+
+    for (int line = 0; line < ppu::lines_per_frame; ++line)
+    {
+        if (line == 0)
+        {
+            types[line] = ppu::first_visible;
+        }
+        else if (line < 240)
+        {
+            types[line] = ppu::visible;
+        }
+        else if (line == 240)
+        {
+            types[line] = ppu::post;
+        }
+        else if (line == 241)
+        {
+            types[line] = ppu::nmi;
+        }
+        else if (line == ppu::lines_per_frame - 1)
+        {
+            types[line] = ppu::pre;
+        }
+        else
+        {
+            types[line] = ppu::idle;
+        }
+    }
+
+    return types;
+}
+
+// Bit 7 - i of a byte moved to bit 0 of byte i, for turning a bitplane into
+// one byte per pixel in left-to-right order
+constexpr auto build_bit_spread() -> std::array<uint64_t, 256>
+{
+    std::array<uint64_t, 256> table {};
+
+    for (int byte = 0; byte < 256; ++byte)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            table[byte] |= static_cast<uint64_t>((byte >> (7 - i)) & 1) << (i * 8);
+        }
+    }
+
+    return table;
+}
+
+constexpr auto bit_spread = build_bit_spread();
+
+// A 2-bit palette number times this lands in bits 2-3 of all 8 bytes
+constexpr uint64_t palette_spread = 0x0404040404040404;
+
+// For horizontally flipped sprites
+constexpr auto reverse_bits(uint8_t byte) -> uint8_t
+{
+    uint8_t reversed = 0;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        reversed |= ((byte >> i) & 1) << (7 - i);
+    }
+
+    return reversed;
+}
+
+constexpr auto dot_actions = build_dot_actions();
+static_assert(dot_actions[ppu::visible][257]
+                  == (ppu::shift_bg | ppu::reload_bg | ppu::fetch_nt | ppu::copy_x_bits | ppu::load_sprite_zero),
+              "dot 257 reloads the shifters, fetches a nametable byte, resets horizontal scroll and fetches sprites");
+static_assert(dot_actions[ppu::visible][260] == ppu::count_scanline,
+              "dot 260 does nothing but the first sprite pattern fetch");
+constexpr auto line_types = build_line_types();
+
+// What a replica's CHR windows show when its view has no CHR at all
+const uint8_t no_chr[mapper::chr_window_size] = {};
+
+}  // namespace
 
 ppu::ppu() : m_scanline(0), m_pixel(0)
 {
-    init(m_window, m_renderer, screen_width * 2, screen_height * 2);
-    m_render_target =
-        std::shared_ptr<SDL_Texture>(SDL_CreateTexture(&*m_renderer,
-                                                       SDL_PIXELFORMAT_ARGB8888,
-                                                       SDL_TEXTUREACCESS_STREAMING,
-                                                       screen_width,
-                                                       screen_height),
-                                     SDL_DestroyTexture);
+    m_frames = std::make_shared<frame_buffer>();
+    grab_back_buffer();
 
     for (auto& byte : m_vram)
     {
@@ -35,11 +204,37 @@ ppu::ppu() : m_scanline(0), m_pixel(0)
     }
 }
 
+ppu::~ppu() = default;
+
 auto ppu::connect_cartridge(std::shared_ptr<cartridge>& cart) -> void
 {
     m_cart = cart;
 }
 
+auto ppu::connect_frame_buffer(std::shared_ptr<frame_buffer>& frames) -> void
+{
+    m_frames = frames;
+    grab_back_buffer();
+    m_have_drawn_frame = false;
+    m_reusing_frame = false;
+}
+
+auto ppu::grab_back_buffer() -> void
+{
+    if (m_frames->format() == frame_buffer::palette_index)
+    {
+        m_frame_buffer = nullptr;
+        m_index_buffer = m_frames->back_indices();
+        m_line_emphasis = m_frames->back_emphasis();
+    }
+    else
+    {
+        m_frame_buffer = m_frames->back();
+        m_index_buffer = nullptr;
+        m_line_emphasis = nullptr;
+    }
+}
+
 auto ppu::reset() -> void
 {
     m_latch = false;
@@ -48,20 +243,22 @@ auto ppu::reset() -> void
     m_ctrl.ctrl = 0;
     m_mask.mask = 0;
     m_status.status = 0;
+    select_palette();
 
-    SDL_SetRenderTarget(&*m_renderer, &*m_render_target);
-    SDL_SetRenderDrawColor(&*m_renderer, 0x00, 0x00, 0x00, 0xFF);
-    SDL_Rect fill_rect = {0, 0, screen_width, screen_height};
-    SDL_RenderFillRect(&*m_renderer, &fill_rect);
-    SDL_SetRenderTarget(&*m_renderer, nullptr);
-    SDL_RenderCopy(&*m_renderer, &*m_render_target, &fill_rect, nullptr);
-    SDL_RenderPresent(&*m_renderer);
+    m_have_drawn_frame = false;
+    m_reusing_frame = false;
 }
 
 auto ppu::reg_read(uint16_t addr) -> uint8_t
 {
     uint8_t byte = 0x00;
 
+    // Reads of $2002 and $2007 move the write latch and v
+    if (m_logging and (addr == 0x02 or addr == 0x07))
+    {
+        log_access(logged_access::reg_read, addr, 0);
+    }
+
     switch (addr)
     {
         case 0x02:
@@ -73,6 +270,7 @@ auto ppu::reg_read(uint16_t addr) -> uint8_t
             byte = m_oam.at(m_oam_addr);
             break;
         case 0x07:
+            mark_raster_activity();
             byte = m_read_buffer;
             m_read_buffer = bus_read(m_vram_addr.addr);
             if (m_vram_addr.addr >= 0x3F00)  // in palette part of RAM
@@ -99,23 +297,32 @@ auto ppu::reg_read(uint16_t addr) -> uint8_t
 
 auto ppu::reg_write(uint16_t addr, uint8_t byte) -> void
 {
+    if (m_logging)
+    {
+        log_access(logged_access::reg_write, addr, byte);
+    }
+
     switch (addr)
     {
         case 0x00:
+            mark_raster_activity();
             m_ctrl.ctrl = byte;
             m_temp_addr.nametable_x = m_ctrl.nametable_x;
             m_temp_addr.nametable_y = m_ctrl.nametable_y;
             break;
         case 0x01:
+            mark_raster_activity();
             m_mask.mask = byte;
+            select_palette();
             break;
         case 0x03:
             m_oam_addr = byte;
             break;
         case 0x04:
-            m_oam.at(m_oam_addr) = byte;
+            oam_write(m_oam_addr, byte);
             break;
         case 0x05:
+            mark_raster_activity();
             if (!m_latch)
             {
                 m_fine_x = (byte & 0x07);
@@ -130,6 +337,7 @@ auto ppu::reg_write(uint16_t addr, uint8_t byte) -> void
             }
             break;
         case 0x06:
+            mark_raster_activity();
             if (!m_latch)
             {
                 m_temp_addr.high_byte = (byte & 0x3F);
@@ -143,6 +351,7 @@ auto ppu::reg_write(uint16_t addr, uint8_t byte) -> void
             }
             break;
         case 0x07:
+            mark_raster_activity();
             bus_write(m_vram_addr.addr, byte);
             if (m_ctrl.vram_inc == 1)
             {
@@ -168,45 +377,18 @@ auto ppu::bus_read(uint16_t addr) -> uint8_t
     switch (addr)
     {
         case 0x0000 ... 0x1FFF:
-            m_cart->ppu_read(addr, byte);
-            break;
-        case 0x2000 ... 0x3EFF:
-            addr &= 0x0FFF;
-            if (m_cart->get_mirroring())
+            if (m_replica)
             {
-                switch (addr & 0x0FFF)
-                {
-                    case 0x0000 ... 0x03FF:
-                    case 0x0800 ... 0x0BFF:
-                        byte = m_vram.at(addr & 0x03FF);
-                        break;
-                    case 0x0400 ... 0x07FF:
-                    case 0x0C00 ... 0x0FFF:
-                        byte = m_vram.at((addr & 0x07FF));
-                        break;
-                    default:
-                        printf("NOTE: Unable to read VRAM at location $%04X\n", addr);
-                        break;
-                }
+                byte = m_view_windows[(addr >> 10) & 0x07][addr & 0x03FF];
             }
             else
             {
-                switch (addr & 0x0FFF)
-                {
-                    case 0x0000 ... 0x03FF:
-                    case 0x0400 ... 0x07FF:
-                        byte = m_vram.at(addr & 0x03FF);
-                        break;
-                    case 0x0800 ... 0x0BFF:
-                    case 0x0C00 ... 0x0FFF:
-                        byte = m_vram.at((addr & 0x07FF));
-                        break;
-                    default:
-                        printf("NOTE: Unable to read VRAM at location $%04X\n", addr);
-                        break;
-                }
+                m_cart->ppu_read(addr, byte);
             }
             break;
+        case 0x2000 ... 0x3EFF:
+            byte = m_vram.at(nametable_offset(addr));
+            break;
         case 0x3F00 ... 0x3FFF:
             byte = m_pal_ram.at(addr & 0x1F);
             break;
@@ -217,49 +399,34 @@ auto ppu::bus_read(uint16_t addr) -> uint8_t
 
 auto ppu::bus_write(uint16_t addr, uint8_t byte) -> void
 {
+    // Plenty of games re-upload the same nametable and palette data every
+    // vblank, so only a write that changes something counts
+    if (bus_read(addr) != byte)
+    {
+        mark_dirty();
+    }
+
     switch (addr)
     {
         case 0x0000 ... 0x1FFF:
-            m_cart->ppu_write(addr, byte);
-            printf("NOTE: Writing from PPU to cartridge at addr %04X\n", addr);
-            break;
-        case 0x2000 ... 0x3EFF:
-            addr &= 0x0FFF;
-            if (m_cart->get_mirroring())
+            // A replica sees the write a frame late; the real PPU made it, so
+            // this only goes to the replica's copy of CHR-RAM. CHR-RAM takes
+            // writes all the time; only CHR-ROM is worth a note.
+            if (m_replica)
             {
-                switch (addr & 0x0FFF)
+                if (!m_view.chr_ram.empty())
                 {
-                    case 0x0000 ... 0x03FF:
-                    case 0x0800 ... 0x0BFF:
-                        m_vram.at(addr & 0x03FF) = byte;
-                        break;
-                    case 0x0400 ... 0x07FF:
-                    case 0x0C00 ... 0x0FFF:
-                        m_vram.at((addr & 0x07FF)) = byte;
-                        break;
-                    default:
-                        printf("NOTE: Unable to write %02X to VRAM at location $%04X\n", byte, addr);
-                        break;
+                    const uint8_t* window = m_view_windows[(addr >> 10) & 0x07];
+                    m_view.chr_ram[(window - m_view.chr_ram.data()) + (addr & 0x03FF)] = byte;
                 }
             }
-            else
+            else if (!m_cart->ppu_write(addr, byte))
             {
-                switch (addr & 0x0FFF)
-                {
-                    case 0x0000 ... 0x03FF:
-                    case 0x0400 ... 0x07FF:
-                        m_vram.at(addr & 0x03FF) = byte;
-                        break;
-                    case 0x0800 ... 0x0BFF:
-                    case 0x0C00 ... 0x0FFF:
-                        m_vram.at((addr & 0x07FF)) = byte;
-                        break;
-                    default:
-                        printf("NOTE: Unable to write %02X to VRAM at location $%04X\n", byte, addr);
-                        break;
-                }
+                printf("NOTE: Writing from PPU to cartridge at addr %04X\n", addr);
             }
-
+            break;
+        case 0x2000 ... 0x3EFF:
+            m_vram.at(nametable_offset(addr)) = byte;
             break;
         case 0x3F00 ... 0x3FFF:
             m_pal_ram.at(addr & 0x1F) = byte;
@@ -267,119 +434,185 @@ auto ppu::bus_write(uint16_t addr, uint8_t byte) -> void
     }
 }
 
-auto ppu::clock(line_type type) -> void
+auto ppu::nametable_offset(uint16_t addr) const -> uint16_t
+{
+    uint16_t offset = 0;
+
+    if (m_replica)
+    {
+        offset = m_view.nametables[(addr >> 10) & 0x03] | (addr & 0x03FF);
+    }
+    else
+    {
+        offset = m_cart->nametable_offset(addr);
+    }
+
+    return offset;
+}
+
+auto ppu::clock() -> void
 {
-    if (type == visible or type == pre)
+    uint16_t actions = dot_actions[line_types[m_scanline]][m_pixel];
+
+    if (actions != 0)
     {
-        if (m_scanline == 0 and m_pixel == 0)
+        // This PPU always skips dot 0 of line 0, odd frame or not
+        if ((actions & skip_dot) != 0)
         {
             m_pixel++;
+            actions = dot_actions[first_visible][m_pixel];
         }
 
-        if (type == pre and m_pixel == 1)
+        if ((actions & clear_vblank) != 0)
         {
             m_status.vblank = 0;
+            m_status.zero_hit = 0;
         }
 
-        switch (m_pixel)
+        if ((actions & shift_bg) != 0)
         {
-            case 2 ... 257:
-            case 321 ... 337:
-                shift();
-                switch ((m_pixel - 1) % 8)
-                {
-                    case 0:
-                        reload();
-                        m_nt_byte = bus_read(0x2000 | (m_vram_addr.addr & 0x0FFF));
-                        break;
-                    case 2:
-                        m_attr_byte = bus_read(0x23C0 | (m_vram_addr.addr & 0x0C00)
-                                               | ((m_vram_addr.addr >> 4) & 0x38)
-                                               | ((m_vram_addr.addr >> 2) & 0x07));
-                        if ((m_vram_addr.coarse_y & 0x2) == 0x2)
-                        {
-                            m_attr_byte >>= 4;
-                        }
-                        if ((m_vram_addr.coarse_x & 0x2) == 0x2)
-                        {
-                            m_attr_byte >>= 2;
-                        }
-
-                        // don't need upper bits for attribute data
-                        m_attr_byte &= 0x3;
-                        break;
-                    case 4:
-                        m_pattern_low =
-                            bus_read((m_ctrl.bg_tbl << 12)
-                                     + (static_cast<uint16_t>(m_nt_byte) << 4)
-                                     + m_vram_addr.fine_y);
-                        break;
-                    case 6:
-                        m_pattern_high =
-                            bus_read((m_ctrl.bg_tbl << 12)
-                                     + (static_cast<uint16_t>(m_nt_byte) << 4)
-                                     + m_vram_addr.fine_y + 8);
-                        break;
-                    case 7:
-                        inc_x();
-                        break;
-                }
+            shift();
+        }
+        if ((actions & reload_bg) != 0)
+        {
+            reload();
+        }
+        if ((actions & fetch_nt) != 0)
+        {
+            m_nt_byte = bus_read(0x2000 | (m_vram_addr.addr & 0x0FFF));
+        }
+        if ((actions & fetch_at) != 0)
+        {
+            m_attr_byte = bus_read(0x23C0 | (m_vram_addr.addr & 0x0C00)
+                                   | ((m_vram_addr.addr >> 4) & 0x38)
+                                   | ((m_vram_addr.addr >> 2) & 0x07));
+            if ((m_vram_addr.coarse_y & 0x2) == 0x2)
+            {
+                m_attr_byte >>= 4;
+            }
+            if ((m_vram_addr.coarse_x & 0x2) == 0x2)
+            {
+                m_attr_byte >>= 2;
+            }
 
-                if (m_pixel == 256)
-                {
-                    inc_y();
-                }
+            // don't need upper bits for attribute data
+            m_attr_byte &= 0x3;
+        }
+        if ((actions & fetch_pattern_low) != 0)
+        {
+            m_pattern_low =
+                bus_read((m_ctrl.bg_tbl << 12)
+                         + (static_cast<uint16_t>(m_nt_byte) << 4)
+                         + m_vram_addr.fine_y);
+        }
+        if ((actions & fetch_pattern_high) != 0)
+        {
+            m_pattern_high =
+                bus_read((m_ctrl.bg_tbl << 12)
+                         + (static_cast<uint16_t>(m_nt_byte) << 4)
+                         + m_vram_addr.fine_y + 8);
+        }
 
-                if (m_pixel == 257)
-                {
-                    reload();
-                    copy_x();
-                }
-                break;
-            case 338:
-            case 340:
-                m_nt_byte = bus_read(0x2000 | (m_vram_addr.addr & 0x0FFF));
-                break;
-            case 280 ... 304:
-                if (type == pre)
-                {
-                    copy_y();
-                }
-                break;
+        scroll(actions);
+
+        if ((actions & load_sprite_zero) != 0)
+        {
+            latch_sprite_zero();
         }
-    }
 
-    if (type == nmi and m_pixel == 1)
-    {
-        m_status.vblank = 1;
+        if ((actions & count_scanline) != 0)
+        {
+            count_scanline_edge();
+        }
 
-        if (m_ctrl.do_nmi == 1)
+        if ((actions & set_vblank) != 0)
         {
-            m_do_interr = true;
+            m_status.vblank = 1;
+
+            if (m_ctrl.do_nmi == 1)
+            {
+                m_do_interr = true;
+            }
         }
     }
 
-    uint8_t bg_pix = 0;
-    uint8_t bg_pal = 0;
-
-    if (m_mask.show_bg)
+    // Everything above keeps running on skipped frames, so the registers,
+    // scrolling and vblank timing stay exact; only pixel output is dropped
+    if (m_render_frame and !m_reusing_frame and m_pipeline == nullptr
+        and m_scanline < screen_height and m_pixel < screen_width)
     {
-        uint16_t mask = 0x8000 >> m_fine_x;
+        uint8_t bg_entry = 0;
+
+        if (m_mask.show_bg)
+        {
+            bg_entry = m_bg_queue[(m_bg_head + m_fine_x) & (bg_queue_size - 1)];
+        }
+
+        if (m_zero_row.on_line)
+        {
+            check_zero_hit(bg_entry);
+        }
 
-        uint8_t pix_low = ((m_p_shift_low & mask) > 0 ? 1 : 0);
-        uint8_t pix_high = ((m_p_shift_high & mask) > 0 ? 1 : 0);
+        uint8_t color = get_color_index(bg_entry >> 2, bg_entry & 0x03);
+        int offset = (m_scanline * screen_width) + m_pixel;
 
-        bg_pix = (pix_high << 1) | pix_low;
+        if (m_index_buffer != nullptr)
+        {
+            // Emphasis is only kept per line, as of the line's first pixel
+            // (pixel 1 on line 0, where dot 0 is skipped)
+            if (m_pixel <= 1)
+            {
+                m_line_emphasis[m_scanline] = m_emphasis;
+            }
+            m_index_buffer[offset] = color;
+        }
+        else
+        {
+            m_frame_buffer[offset] = m_palette[color];
+        }
+    }
+    else if (m_zero_row.on_line and m_scanline < screen_height and m_pixel < screen_width)
+    {
+        track_zero_hit();
+    }
+}
 
-        uint8_t pal_low = ((m_a_shift_low & mask) > 0 ? 1 : 0);
-        uint8_t pal_high = ((m_a_shift_high & mask) > 0 ? 1 : 0);
+auto ppu::count_scanline_edge() -> void
+{
+    // MMC3's counter clocks when A12 goes high after being low a while,
+    // which happens once a line, and only when the two kinds of fetch use
+    // different pattern tables: dot 260 with the background at $0000 and
+    // sprites at $1000, dot 324 the other way round. 8x16 sprites are
+    // counted as $1000, where games keep them (and the empty sprite slots
+    // fetch tile $FF from).
+    bool sprites_high = m_ctrl.sprite_size == 1 or m_ctrl.sprite_tbl == 1;
+    bool edge = m_pixel == 260 ? (m_ctrl.bg_tbl == 0 and sprites_high) : (m_ctrl.bg_tbl == 1 and !sprites_high);
 
-        bg_pal = (pal_high << 1) | pal_low;
+    // A replica leaves the (shared) cartridge to the real PPU
+    if (edge and (m_mask.show_bg or m_mask.show_sprites) and !m_replica)
+    {
+        m_cart->scanline();
     }
+}
 
-    SDL_Color col = get_color(bg_pal, bg_pix);
-    Uint32 final_pixel = (0xFF << 24) | (col.r << 16) | (col.g << 8) | (col.b);
-    m_frame_buffer[(m_scanline * screen_width) + m_pixel] = final_pixel;
+auto ppu::scroll(uint16_t actions) -> void
+{
+    if ((actions & increment_x) != 0)
+    {
+        inc_x();
+    }
+    if ((actions & increment_y) != 0)
+    {
+        inc_y();
+    }
+    if ((actions & copy_x_bits) != 0)
+    {
+        copy_x();
+    }
+    if ((actions & copy_y_bits) != 0)
+    {
+        copy_y();
+    }
 }
 
 auto ppu::nonmask() -> bool
@@ -402,24 +635,7 @@ auto ppu::interr() -> bool
 
 auto ppu::step() -> void
 {
-    switch (m_scanline)
-    {
-        case 0 ... 239:
-            clock(visible);
-            break;
-        case 240:
-            clock(post);
-            break;
-        case 241:
-            clock(nmi);
-            break;
-        case 261:
-            clock(pre);
-            break;
-        default:
-            clock(idle);
-            break;
-    }
+    clock();
 
     m_pixel++;
     if (m_pixel > 340)
@@ -429,18 +645,456 @@ auto ppu::step() -> void
         m_scanline++;
         if (m_scanline > 261)
         {
-            printf("Frame complete\n");
-            SDL_Rect src_rect = {0, 0, screen_width, screen_height};
-            SDL_UpdateTexture(&*m_render_target, nullptr, m_frame_buffer, m_pitch);
-            SDL_SetRenderTarget(&*m_renderer, nullptr);
-            SDL_RenderCopy(&*m_renderer, &*m_render_target, &src_rect, nullptr);
-            SDL_RenderPresent(&*m_renderer);
-            SDL_SetRenderTarget(&*m_renderer, &*m_render_target);
+            // Hand the finished frame to the presenter and carry on drawing
+            // into whichever slot it gave back; this never blocks. Skipped
+            // frames have nothing worth showing, so they aren't handed over.
+            if (m_pipeline != nullptr)
+            {
+                if (m_logging)
+                {
+                    m_pipeline->submit(m_log);
+                }
+            }
+            else if (m_reusing_frame)
+            {
+                m_static_frames++;
+                m_reusing_frame = false;
+            }
+            else if (m_render_frame)
+            {
+                m_frames->publish();
+                grab_back_buffer();
+                m_have_drawn_frame = true;
+            }
+
+            m_frame_count++;
             m_scanline = 0;
+
+            if (m_frame_skip == frame_skip_auto)
+            {
+                m_render_frame = !m_behind_schedule or m_skip_run >= max_auto_skip;
+            }
+            else
+            {
+                m_render_frame = m_skip_run >= m_frame_skip;
+            }
+
+            m_skip_run = m_render_frame ? 0 : m_skip_run + 1;
+
+            if (m_pipeline != nullptr)
+            {
+                // Skipped frames don't get logged, let alone drawn
+                m_logging = m_render_frame;
+                if (m_logging)
+                {
+                    save_state(m_log.start);
+                    m_log.accesses.clear();
+                    m_logged_pages = m_log.start.view.chr_pages;
+                    m_logged_nametables = m_log.start.view.nametables;
+                }
+            }
+            else if (m_render_frame and !m_replica)
+            {
+                // A replica starts its frames in replay(), once it has the
+                // logged state to start from
+                begin_frame();
+            }
         }
     }
 }
 
+auto ppu::set_frame_skip(int frames) -> void
+{
+    m_frame_skip = frames;
+    m_skip_run = 0;
+}
+
+auto ppu::set_behind_schedule(bool behind) -> void
+{
+    m_behind_schedule = behind;
+}
+
+auto ppu::frame_count() const -> uint64_t
+{
+    return m_frame_count;
+}
+
+auto ppu::static_frames() const -> uint64_t
+{
+    return m_static_frames;
+}
+
+auto ppu::invalidate_frame() -> void
+{
+    if (m_logging)
+    {
+        log_cartridge_changes();
+        log_access(logged_access::invalidate, 0, 0);
+    }
+
+    mark_dirty();
+}
+
+auto ppu::set_pipelined(bool pipelined, int band_workers) -> void
+{
+    // Always starts over, so the old worker finishes what it was given
+    m_pipeline = nullptr;
+
+    if (pipelined)
+    {
+        m_pipeline = std::make_unique<render_pipeline>(m_frames, band_workers);
+    }
+
+    // The first log starts at the top of the next frame
+    m_logging = false;
+
+    m_have_drawn_frame = false;
+    m_reusing_frame = false;
+}
+
+auto ppu::current_dot() const -> uint32_t
+{
+    return static_cast<uint32_t>(m_scanline * dots_per_line + m_pixel);
+}
+
+auto ppu::log_access(logged_access::kind type, uint16_t addr, uint16_t value) -> void
+{
+    m_log.accesses.push_back({current_dot(), type, static_cast<uint8_t>(addr), value});
+}
+
+auto ppu::log_cartridge_changes() -> void
+{
+    for (int window = 0; window < mapper::chr_window_count; ++window)
+    {
+        uint16_t page = static_cast<uint16_t>(m_cart->chr_page(window));
+        if (page != m_logged_pages[window])
+        {
+            log_access(logged_access::chr_bank, static_cast<uint16_t>(window), page);
+            m_logged_pages[window] = page;
+        }
+    }
+
+    for (int table = 0; table < 4; ++table)
+    {
+        uint16_t offset = m_cart->nametable_offset(static_cast<uint16_t>(0x2000 + table * 0x400));
+        if (offset != m_logged_nametables[table])
+        {
+            log_access(logged_access::nametable, static_cast<uint16_t>(table), offset);
+            m_logged_nametables[table] = offset;
+        }
+    }
+}
+
+auto ppu::point_view_windows() -> void
+{
+    const uint8_t* chr = m_view.chr_ram.empty() ? m_view.chr_rom : m_view.chr_ram.data();
+    size_t chr_size = m_view.chr_ram.empty() ? static_cast<size_t>(m_view.chr_rom_size) : m_view.chr_ram.size();
+
+    for (int window = 0; window < mapper::chr_window_count; ++window)
+    {
+        size_t offset = chr_size > 0 ? (m_view.chr_pages[window] * size_t {mapper::chr_window_size}) % chr_size : 0;
+        m_view_windows[window] = chr_size > 0 ? chr + offset : no_chr;
+    }
+}
+
+auto ppu::save_state(snapshot& state) const -> void
+{
+    state.vram = m_vram;
+    state.pal_ram = m_pal_ram;
+    state.oam = m_oam;
+    state.oam_addr = m_oam_addr;
+
+    state.ctrl = m_ctrl.ctrl;
+    state.mask = m_mask.mask;
+    state.status = m_status.status;
+    state.latch = m_latch;
+    state.vram_addr = m_vram_addr.addr;
+    state.temp_addr = m_temp_addr.addr;
+    state.fine_x = m_fine_x;
+    state.read_buffer = m_read_buffer;
+
+    state.nt_byte = m_nt_byte;
+    state.attr_byte = m_attr_byte;
+    state.pattern_low = m_pattern_low;
+    state.pattern_high = m_pattern_high;
+    // Snapshots keep the queue in its shift register form
+    state.p_shift_low = 0;
+    state.p_shift_high = 0;
+    state.a_shift_low = 0;
+    state.a_shift_high = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        uint8_t entry = m_bg_queue[(m_bg_head + i) & (bg_queue_size - 1)];
+        int bit = 15 - i;
+
+        state.p_shift_low |= (entry & 0x01) << bit;
+        state.p_shift_high |= ((entry >> 1) & 0x01) << bit;
+        state.a_shift_low |= ((entry >> 2) & 0x01) << bit;
+        state.a_shift_high |= ((entry >> 3) & 0x01) << bit;
+    }
+
+    state.scanline = m_scanline;
+    state.pixel = m_pixel;
+
+    // A replica passes on the view it has reached; the real PPU takes the
+    // cartridge's as it is now
+    if (m_replica)
+    {
+        state.view = m_view;
+    }
+    else if (m_cart != nullptr)
+    {
+        m_cart->save_ppu_view(state.view);
+    }
+}
+
+auto ppu::load_state(const snapshot& state) -> void
+{
+    // Goes through the same checks as a write would, so static-frame
+    // detection still sees what changed
+    if (state.vram != m_vram or state.pal_ram != m_pal_ram or state.oam != m_oam)
+    {
+        mark_dirty();
+    }
+    else if (state.view.chr_pages != m_view.chr_pages
+             or state.view.nametables != m_view.nametables
+             or state.view.chr_rom != m_view.chr_rom
+             or state.view.chr_ram != m_view.chr_ram)
+    {
+        mark_dirty();
+    }
+
+    m_vram = state.vram;
+    m_pal_ram = state.pal_ram;
+    m_oam = state.oam;
+    m_oam_addr = state.oam_addr;
+
+    m_ctrl.ctrl = state.ctrl;
+    m_mask.mask = state.mask;
+    m_status.status = state.status;
+    m_latch = state.latch;
+    m_vram_addr.addr = state.vram_addr;
+    m_temp_addr.addr = state.temp_addr;
+    m_fine_x = state.fine_x;
+    m_read_buffer = state.read_buffer;
+
+    m_nt_byte = state.nt_byte;
+    m_attr_byte = state.attr_byte;
+    m_pattern_low = state.pattern_low;
+    m_pattern_high = state.pattern_high;
+    m_bg_queue.fill(0);
+    m_bg_head = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        int bit = 15 - i;
+
+        m_bg_queue[i] = static_cast<uint8_t>(((state.p_shift_low >> bit) & 0x01)
+                                             | (((state.p_shift_high >> bit) & 0x01) << 1)
+                                             | (((state.a_shift_low >> bit) & 0x01) << 2)
+                                             | (((state.a_shift_high >> bit) & 0x01) << 3));
+    }
+
+    m_scanline = state.scanline;
+    m_pixel = state.pixel;
+
+    m_view = state.view;
+    point_view_windows();
+
+    // Snapshots don't carry sprite 0's row, so the next line fetches it anew
+    m_zero_row = {};
+    m_zero_predicted = false;
+
+    select_palette();
+}
+
+auto ppu::replay(const frame_log& log) -> void
+{
+    m_replica = true;
+    load_state(log.start);
+    begin_frame();
+
+    // Run the frame through to the hand-off at the end, applying each access
+    // just before the dot it was made at
+    size_t next = 0;
+    uint64_t frame = m_frame_count;
+
+    while (m_frame_count == frame)
+    {
+        apply_accesses(log, next, current_dot());
+        step();
+    }
+}
+
+auto ppu::apply_accesses(const frame_log& log, size_t& next, uint32_t dot) -> void
+{
+    while (next < log.accesses.size() and log.accesses[next].dot <= dot)
+    {
+        const logged_access& access = log.accesses[next++];
+
+        switch (access.type)
+        {
+            case logged_access::reg_read:
+                reg_read(access.addr);
+                break;
+            case logged_access::reg_write:
+                reg_write(access.addr, static_cast<uint8_t>(access.value));
+                break;
+            case logged_access::oam_write:
+                oam_write(access.addr, static_cast<uint8_t>(access.value));
+                break;
+            case logged_access::invalidate:
+                invalidate_frame();
+                break;
+            case logged_access::chr_bank:
+                m_view.chr_pages[access.addr] = access.value;
+                point_view_windows();
+                mark_dirty();
+                break;
+            case logged_access::nametable:
+                m_view.nametables[access.addr] = access.value;
+                mark_dirty();
+                break;
+        }
+    }
+}
+
+auto ppu::advance_to(const frame_log& log, size_t& next, uint32_t dot) -> void
+{
+    m_replica = true;
+
+    // Only what moves v (and the accesses, which can move anything) happens
+    // here; fetches, shifters and pixels are left for draw_lines(), which
+    // redoes the prefetch it needs
+    while (current_dot() < dot)
+    {
+        apply_accesses(log, next, current_dot());
+
+        uint16_t actions = dot_actions[line_types[m_scanline]][m_pixel];
+        if ((actions & skip_dot) != 0)
+        {
+            m_pixel++;
+        }
+        else
+        {
+            scroll(actions);
+        }
+
+        m_pixel++;
+        if (m_pixel == dots_per_line)
+        {
+            m_pixel = 0;
+            m_scanline++;
+        }
+    }
+}
+
+auto ppu::draw_lines(const frame_log& log, const snapshot& start, int last_line, frame_buffer& frames) -> void
+{
+    m_replica = true;
+    load_state(start);
+
+    m_render_frame = true;
+    m_reusing_frame = false;
+    if (frames.format() == frame_buffer::palette_index)
+    {
+        m_frame_buffer = nullptr;
+        m_index_buffer = frames.back_indices();
+        m_line_emphasis = frames.back_emphasis();
+    }
+    else
+    {
+        m_frame_buffer = frames.back();
+        m_index_buffer = nullptr;
+        m_line_emphasis = nullptr;
+    }
+
+    // Starts either at the top of the frame or at the previous line's tile
+    // prefetch, and stops once the band's last pixel is out
+    uint32_t first_dot = current_dot();
+    uint32_t end_dot = static_cast<uint32_t>((last_line - 1) * dots_per_line + screen_width);
+    size_t next = std::lower_bound(log.accesses.begin(),
+                                   log.accesses.end(),
+                                   first_dot,
+                                   [](const logged_access& access, uint32_t dot) { return access.dot < dot; })
+        - log.accesses.begin();
+
+    while (current_dot() < end_dot)
+    {
+        apply_accesses(log, next, current_dot());
+        step();
+    }
+}
+
+auto ppu::raster_state::operator==(const raster_state& other) const -> bool
+{
+    return vram_addr == other.vram_addr
+        and fine_x == other.fine_x
+        and ctrl == other.ctrl
+        and mask == other.mask;
+}
+
+auto ppu::begin_frame() -> void
+{
+    // v has just been reloaded from t on the pre-render line, so together
+    // with fine x, $2000 and $2001 it pins down what gets drawn from memory
+    raster_state state = {m_vram_addr.addr, m_fine_x, m_ctrl.ctrl, m_mask.mask};
+
+    m_reusing_frame = m_have_drawn_frame
+        and !m_raster_activity
+        and m_dirty_generation == m_drawn_generation
+        and state == m_drawn_state;
+
+    m_drawn_generation = m_dirty_generation;
+    m_drawn_state = state;
+    m_raster_activity = false;
+}
+
+auto ppu::mark_dirty() -> void
+{
+    m_dirty_generation++;
+    m_zero_predicted = false;
+
+    if (m_reusing_frame and m_scanline < screen_height)
+    {
+        stop_reusing_frame();
+    }
+}
+
+auto ppu::mark_raster_activity() -> void
+{
+    // Register writes between frames are covered by comparing the raster
+    // state at the top of the next one
+    if (m_scanline < screen_height)
+    {
+        m_raster_activity = true;
+        m_zero_predicted = false;
+
+        if (m_reusing_frame)
+        {
+            stop_reusing_frame();
+        }
+    }
+}
+
+auto ppu::stop_reusing_frame() -> void
+{
+    // Everything up to here matched the last published frame, so that's
+    // where the lines already passed (and this one) come from
+    int lines = m_scanline + 1;
+
+    if (m_index_buffer != nullptr)
+    {
+        std::copy_n(m_frames->previous_indices(), lines * screen_width, m_index_buffer);
+        std::copy_n(m_frames->previous_emphasis(), lines, m_line_emphasis);
+    }
+    else
+    {
+        std::copy_n(m_frames->previous(), lines * screen_width, m_frame_buffer);
+    }
+
+    m_reusing_frame = false;
+}
+
 auto ppu::copy_x() -> void
 {
     if (m_mask.show_bg or m_mask.show_sprites)
@@ -512,35 +1166,217 @@ auto ppu::inc_y() -> void
 
 auto ppu::reload() -> void
 {
-    m_p_shift_low = (m_p_shift_low & 0xFF00) | m_pattern_low;
-    m_p_shift_high = (m_p_shift_high & 0xFF00) | m_pattern_high;
+    // Both bitplanes spread out to a byte per pixel and interleaved, with the
+    // tile's palette (borrowed from javid9x's NES emulator: the attribute
+    // applies to all 8 pixels) in bits 2-3 of every byte
+    uint64_t pixels = bit_spread[m_pattern_low]
+        | (bit_spread[m_pattern_high] << 1)
+        | (palette_spread * m_attr_byte);
 
-    // Borrowed from javid9x's NES emulator
-    // Fills the entire shift register with whatever the latch would've been
-    // latched to, so you can shift them alongside the pattern table shifters
-    m_a_shift_low =
-        (m_a_shift_low & 0xFF00) | ((m_attr_byte & 1) ? 0xFF : 0x00);
-    m_a_shift_high =
-        (m_a_shift_high & 0xFF00) | ((m_attr_byte & 2) ? 0xFF : 0x00);
+    // Byte i of the spread value is pixel i, so on little-endian hosts the
+    // tile goes in with one store unless it wraps around the end
+    int back = (m_bg_head + 8) & (bg_queue_size - 1);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (back <= bg_queue_size - 8)
+#else
+    if (false)
+#endif
+    {
+        std::memcpy(&m_bg_queue[back], &pixels, sizeof(pixels));
+    }
+    else
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            m_bg_queue[(back + i) & (bg_queue_size - 1)] = static_cast<uint8_t>(pixels >> (i * 8));
+        }
+    }
 }
 
 auto ppu::shift() -> void
 {
     if (m_mask.show_bg)
     {
-        m_p_shift_low <<= 1;
-        m_p_shift_high <<= 1;
-        m_a_shift_low <<= 1;
-        m_a_shift_high <<= 1;
+        // What comes into view at the back is empty, as the zeros shifted
+        // into a register would be
+        m_bg_queue[(m_bg_head + 16) & (bg_queue_size - 1)] = 0;
+        m_bg_head = (m_bg_head + 1) & (bg_queue_size - 1);
     }
 }
 
-auto ppu::get_color(uint8_t pal, uint8_t pix) -> SDL_Color
+auto ppu::select_palette() -> void
+{
+    m_emphasis = m_mask.mask >> 5;
+    m_palette = &palette::argb()[m_emphasis * palette::color_count];
+    m_gray_mask = m_mask.grayscale ? 0x30 : 0x3F;
+}
+
+auto ppu::get_color_index(uint8_t pal, uint8_t pix) -> uint8_t
 {
-    return m_colors.at(bus_read(0x3F00 + (pal << 2) + pix) & 0x3F);
+    return bus_read(0x3F00 + (pal << 2) + pix) & m_gray_mask;
 }
 
 auto ppu::oam_write(uint8_t index, uint8_t byte) -> void
 {
+    if (m_logging)
+    {
+        log_access(logged_access::oam_write, index, byte);
+    }
+
+    if (m_oam.at(index) != byte)
+    {
+        mark_dirty();
+    }
+
     m_oam.at(index) = byte;
 }
+
+auto ppu::latch_sprite_zero() -> void
+{
+    // Sprite 0 covers the lines below its Y byte; this fetch is for the next
+    // line, so the row is counted from this one
+    int height = m_ctrl.sprite_size ? 16 : 8;
+    int row = m_scanline - m_oam[0];
+
+    m_zero_row.on_line = (m_mask.show_bg or m_mask.show_sprites)
+        and m_scanline + 1 < screen_height
+        and row >= 0 and row < height;
+
+    if (m_zero_row.on_line)
+    {
+        uint8_t tile = m_oam[1];
+        uint8_t attr = m_oam[2];
+
+        if ((attr & 0x80) == 0x80)
+        {
+            row = height - 1 - row;
+        }
+
+        uint16_t addr = 0;
+        if (height == 16)
+        {
+            // 8x16 sprites pick their table with bit 0 of the tile number
+            addr = static_cast<uint16_t>(((tile & 0x01) << 12) | ((tile & 0xFE) << 4) | ((row & 0x08) << 1) | (row & 0x07));
+        }
+        else
+        {
+            addr = static_cast<uint16_t>((m_ctrl.sprite_tbl << 12) | (tile << 4) | row);
+        }
+
+        m_zero_row.x = m_oam[3];
+        m_zero_row.pattern_low = bus_read(addr);
+        m_zero_row.pattern_high = bus_read(addr + 8);
+
+        if ((attr & 0x40) == 0x40)
+        {
+            m_zero_row.pattern_low = reverse_bits(m_zero_row.pattern_low);
+            m_zero_row.pattern_high = reverse_bits(m_zero_row.pattern_high);
+        }
+    }
+}
+
+auto ppu::zero_hit_allowed(int x) const -> bool
+{
+    // Never on the last pixel, nor where either layer is clipped on the left
+    return m_mask.show_bg and m_mask.show_sprites
+        and !m_status.zero_hit
+        and x != screen_width - 1
+        and (x >= 8 or (m_mask.bg_left and m_mask.sprite_left));
+}
+
+auto ppu::check_zero_hit(uint8_t bg_entry) -> void
+{
+    int column = m_pixel - m_zero_row.x;
+
+    if (column >= 0 and column < 8 and (bg_entry & 0x03) != 0 and zero_hit_allowed(m_pixel))
+    {
+        uint8_t opaque = m_zero_row.pattern_low | m_zero_row.pattern_high;
+
+        if (((opaque << column) & 0x80) == 0x80)
+        {
+            m_status.zero_hit = 1;
+        }
+    }
+}
+
+auto ppu::predict_zero_hit() -> void
+{
+    m_zero_predicted = true;
+    m_zero_hit_dot = -1;
+
+    uint8_t opaque = m_zero_row.pattern_low | m_zero_row.pattern_high;
+
+    for (int column = 0; column < 8 and m_zero_hit_dot < 0; ++column)
+    {
+        int x = m_zero_row.x + column;
+
+        if (x >= screen_width or ((opaque << column) & 0x80) == 0 or !zero_hit_allowed(x))
+        {
+            continue;
+        }
+
+        // Where pixel x sits in this line's stream of background pixels.
+        // Nothing shifts on dots 0 and 1, so pixels 0 and 1 are the same one.
+        // The first two tiles are already queued; later ones are fetched one
+        // tile over from v each, just as the fetches on the way would.
+        int position = m_fine_x + std::max(x - 1, 0);
+        uint8_t bg_pix = 0;
+
+        if (position < 16)
+        {
+            bg_pix = m_bg_queue[(m_bg_head + position) & (bg_queue_size - 1)] & 0x03;
+        }
+        else
+        {
+            addr_reg tile_addr = m_vram_addr;
+            int coarse_x = tile_addr.coarse_x + position / 8 - 2;
+
+            tile_addr.coarse_x = coarse_x & 0x1F;
+            if (coarse_x > 0x1F)
+            {
+                tile_addr.nametable_x = ~tile_addr.nametable_x;
+            }
+
+            uint8_t nt_byte = bus_read(0x2000 | (tile_addr.addr & 0x0FFF));
+            uint16_t pattern = (m_ctrl.bg_tbl << 12) + (static_cast<uint16_t>(nt_byte) << 4) + tile_addr.fine_y;
+            int bit = 7 - position % 8;
+
+            bg_pix = static_cast<uint8_t>(((bus_read(pattern) >> bit) & 0x01)
+                                          | (((bus_read(pattern + 8) >> bit) & 0x01) << 1));
+        }
+
+        if (bg_pix != 0)
+        {
+            m_zero_hit_dot = x;
+        }
+    }
+}
+
+auto ppu::track_zero_hit() -> void
+{
+    // Dot 0 is where the line's first pixel goes out (line 0, where it's
+    // skipped, never has sprites)
+    if (m_pixel == 0)
+    {
+        predict_zero_hit();
+    }
+
+    if (m_zero_predicted)
+    {
+        if (m_pixel == m_zero_hit_dot)
+        {
+            m_status.zero_hit = 1;
+        }
+    }
+    else
+    {
+        uint8_t bg_entry = 0;
+
+        if (m_mask.show_bg)
+        {
+            bg_entry = m_bg_queue[(m_bg_head + m_fine_x) & (bg_queue_size - 1)];
+        }
+
+        check_zero_hit(bg_entry);
+    }
+}
@@ -8,26 +8,138 @@
 #include <memory>
 #include <array>
 #include <cstdint>
+#include <vector>
 
 #include "SDL.h"
 #include "cartridge.hpp"
+#include "frame_buffer.hpp"
+#include "palette.hpp"
+
+class render_pipeline;
 
 class ppu
 {
-    static const int screen_width = 256;
-    static const int screen_height = 240;
+  public:
+    // Everything the picture depends on, as of one instant, so another PPU
+    // can carry on from exactly that point
+    struct snapshot
+    {
+        std::array<uint8_t, 0x800> vram;
+        std::array<uint8_t, 0x20> pal_ram;
+        std::array<uint8_t, 0x100> oam;
+        uint8_t oam_addr;
+
+        uint8_t ctrl;
+        uint8_t mask;
+        uint8_t status;
+        bool latch;
+        uint16_t vram_addr;
+        uint16_t temp_addr;
+        uint8_t fine_x;
+        uint8_t read_buffer;
+
+        uint8_t nt_byte;
+        uint8_t attr_byte;
+        uint8_t pattern_low;
+        uint8_t pattern_high;
+        uint16_t p_shift_low;
+        uint16_t p_shift_high;
+        uint16_t a_shift_low;
+        uint16_t a_shift_high;
+
+        int scanline;
+        int pixel;
+
+        // Empty unless saved with a cartridge connected; only a replica
+        // draws from it
+        cartridge::ppu_view view;
+    };
+
+    // A register access, OAM DMA byte, invalidate_frame() call or change to
+    // the cartridge's CHR banks or mirroring, stamped with the dot it
+    // happened before (scanline * dots_per_line + pixel). A CHR bank entry
+    // is a window and its 1 KB page, a nametable entry a table and its VRAM
+    // offset. CHR-RAM writes need no entry of their own: they are $2007
+    // writes, which a replica makes to its own copy.
+    struct logged_access
+    {
+        enum kind : uint8_t
+        {
+            reg_read,
+            reg_write,
+            oam_write,
+            invalidate,
+            chr_bank,
+            nametable
+        };
+
+        uint32_t dot;
+        kind type;
+        uint8_t addr;
+        uint16_t value;
+    };
+
+    // The state at the top of a frame plus everything the CPU did to the PPU
+    // during it: enough to redraw the frame somewhere else
+    struct frame_log
+    {
+        snapshot start;
+        std::vector<logged_access> accesses;
+    };
 
-    //
-    std::shared_ptr<SDL_Renderer> m_renderer;
-    std::shared_ptr<SDL_Window> m_window;
-    std::shared_ptr<SDL_Texture> m_render_target;
-    Uint32 *m_frame_buffer = new uint32_t[screen_width * screen_height];
-    int m_pitch = screen_width * sizeof(Uint32);
+    static constexpr int dots_per_line = 341;
+    static constexpr int lines_per_frame = 262;
+
+    // Declarations for each possible "cycle types" of the PPU
+    enum line_type
+    {
+        visible,
+        post,
+        nmi,
+        pre,
+        idle,
+        first_visible,
+        line_type_count
+    };
+
+    // Everything the PPU can do on one dot, as bits of a per-dot action mask
+    enum dot_action : uint16_t
+    {
+        shift_bg           = 1 << 0,
+        reload_bg          = 1 << 1,
+        fetch_nt           = 1 << 2,
+        fetch_at           = 1 << 3,
+        fetch_pattern_low  = 1 << 4,
+        fetch_pattern_high = 1 << 5,
+        increment_x        = 1 << 6,
+        increment_y        = 1 << 7,
+        copy_x_bits        = 1 << 8,
+        copy_y_bits        = 1 << 9,
+        set_vblank         = 1 << 10,
+        clear_vblank       = 1 << 11,
+        skip_dot           = 1 << 12,
+        load_sprite_zero   = 1 << 13,
+        count_scanline     = 1 << 14
+    };
+
+  private:
+    static const int screen_width = frame_buffer::width;
+    static const int screen_height = frame_buffer::height;
+
+    // Finished frames get handed off here; m_frame_buffer (or m_index_buffer
+    // and m_line_emphasis, depending on the frame buffer's format) is the slot
+    // being drawn
+    std::shared_ptr<frame_buffer> m_frames;
+    uint32_t *m_frame_buffer = nullptr;
+    uint8_t *m_index_buffer = nullptr;
+    uint8_t *m_line_emphasis = nullptr;
+
+    auto grab_back_buffer() -> void;
 
     std::shared_ptr<cartridge> m_cart = nullptr;
 
-    bool m_do_nmi;
-    bool m_do_interr;
+    bool m_do_nmi = false;
+    bool m_do_interr = false;
 
     bool m_latch = false;
 
@@ -122,14 +234,15 @@ class ppu
     uint8_t m_pattern_low;
     uint8_t m_pattern_high;
 
-    // Pattern table shift register (low)
-    uint16_t m_p_shift_low;
-    // Pattern table shift register (high)
-    uint16_t m_p_shift_high;
-    // Attribute table shift register (low)
-    uint16_t m_a_shift_low;
-    // Attribute table shift register (high)
-    uint16_t m_a_shift_high;
+    // Background pixels waiting to go out, one byte each as palette << 2 |
+    // pixel, which is also the pixel's offset into palette RAM. Stands in for
+    // the four 16-bit pattern/attribute shift registers: entry m_bg_head + i
+    // is what bit 15 - i of those held. reload() expands a whole tile into
+    // the back 8 entries, a shift just moves the head on, and fine x is an
+    // offset from the head.
+    static constexpr int bg_queue_size = 32;
+    std::array<uint8_t, bg_queue_size> m_bg_queue {};
+    uint8_t m_bg_head = 0;
 
     // Helper methods to consolidate PPU operations
     auto copy_x() -> void;
@@ -142,38 +255,44 @@ class ppu
     // General VRAM & Palette
     static const int vram_size = 0x800;
     static const int pal_ram_size = 0x20;
-    static const int colors_size = 0x40;
 
     std::array<uint8_t, vram_size> m_vram;
     std::array<uint8_t, pal_ram_size> m_pal_ram;
-    static constexpr std::array<SDL_Color, colors_size> m_colors = {{
-        // Palette colors from here:
-        // https://www.nesdev.org/wiki/PPU_palettes
-        // Row 1:
-        {84, 84, 84}, {0, 30, 116}, {8, 16, 144}, {48, 0, 136},
-        {68, 0, 100}, {92, 0, 48}, {84, 4, 0}, {60, 24, 0},
-        {32, 42, 0}, {8, 58, 0}, {0, 64, 0}, {0, 60, 0},
-        {0, 50, 60}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0},
-
-        // Row 2:
-        {152, 150, 152}, {8, 76, 196}, {48, 50, 236}, {92, 30, 228},
-        {136, 20, 176}, {160, 20, 100}, {152, 34, 32}, {120, 60, 0},
-        {84, 90, 0}, {40, 114, 0}, {8, 124, 0}, {0, 118, 40},
-        {0, 102, 120}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0},
-
-        // Row 3:
-        {236, 238, 236}, {76, 154, 236}, {120, 124, 236}, {176, 98, 236},
-        {228, 84, 236}, {236, 88, 180}, {236, 106, 100}, {212, 136, 32},
-        {160, 170, 0}, {116, 196, 0}, {76, 208, 32}, {56, 204, 108},
-        {56, 180, 204}, {60, 60, 60}, {0, 0, 0}, {0, 0, 0},
-
-        // Row 4:
-        {236, 238, 236}, {168, 204, 236}, {188, 188, 236}, {212, 178, 236},
-        {236, 174, 236}, {236, 174, 212}, {236, 180, 176}, {228, 196, 144},
-        {204, 210, 120}, {180, 222, 120}, {168, 226, 144}, {152, 226, 180},
-        {160, 214, 228}, {160, 162, 160}, {0, 0, 0}, {0, 0, 0}
-    }};
-    auto get_color(uint8_t pal, uint8_t pix) -> SDL_Color;
+    // The live 64-entry slice of palette::argb() for the current $2001
+    // emphasis bits, and whether grayscale masks the index down to the gray
+    // column. Writes to $2001 just re-point these.
+    const uint32_t *m_palette = palette::argb().data();
+    uint8_t m_gray_mask = 0x3F;
+    uint8_t m_emphasis = 0;
+
+    auto select_palette() -> void;
+    auto get_color_index(uint8_t pal, uint8_t pix) -> uint8_t;
+
+    // Sprite 0 hit. Sprites aren't drawn, but games time raster effects off
+    // this flag, so sprite 0's row for the next line is fetched on dot 257
+    // like the real sprite fetches. Drawn frames test it against each
+    // background pixel as it goes out. Frames that aren't drawn here work out
+    // the hit dot at the start of the line from the tiles under the sprite,
+    // and only fall back to testing dot by dot if something the background
+    // depends on changes partway through the line.
+    struct sprite_zero_row
+    {
+        bool on_line;
+        uint8_t x;
+        // Flipped as needed so bit 7 is the leftmost pixel
+        uint8_t pattern_low;
+        uint8_t pattern_high;
+    };
+
+    sprite_zero_row m_zero_row = {};
+    bool m_zero_predicted = false;
+    int m_zero_hit_dot = -1;
+
+    auto latch_sprite_zero() -> void;
+    auto zero_hit_allowed(int x) const -> bool;
+    auto check_zero_hit(uint8_t bg_entry) -> void;
+    auto predict_zero_hit() -> void;
+    auto track_zero_hit() -> void;
 
     // OAM-related
     static const int oam_size = 0x100;
@@ -184,22 +303,83 @@ class ppu
     int m_scanline;
     int m_pixel;
 
-    // Declarations for each possible "cycle types" of the PPU
-    enum line_type
+    uint64_t m_frame_count = 0;
+
+    // Frame skipping: after each drawn frame, the next m_frame_skip frames run
+    // with full timing but produce no pixels (or, in auto mode, frames are
+    // skipped for as long as the frontend says we're behind)
+    static const int max_auto_skip = 7;
+    int m_frame_skip = 0;
+    int m_skip_run = 0;
+    bool m_render_frame = true;
+    bool m_behind_schedule = false;
+
+    // Static-frame detection. m_dirty_generation moves whenever something
+    // that feeds the picture (VRAM, palette, OAM, CHR) actually changes. A
+    // frame that starts with the same generation and raster state as the last
+    // drawn one, after a frame without mid-frame register writes, is assumed
+    // to come out identical: no pixels are composed and nothing is published.
+    // If that guess is broken partway down the frame, the lines so far are
+    // copied from the last published frame and drawing carries on from there.
+    struct raster_state
     {
-        visible,
-        post,
-        nmi,
-        pre,
-        idle
+        uint16_t vram_addr;
+        uint8_t fine_x;
+        uint8_t ctrl;
+        uint8_t mask;
+
+        auto operator==(const raster_state& other) const -> bool;
     };
 
-    auto clock(line_type type) -> void;
+    uint64_t m_dirty_generation = 0;
+    uint64_t m_drawn_generation = 0;
+    raster_state m_drawn_state = {};
+    bool m_have_drawn_frame = false;
+    bool m_raster_activity = false;
+    bool m_reusing_frame = false;
+    uint64_t m_static_frames = 0;
+
+    // Pipelined rendering: this PPU keeps all the timing but draws nothing,
+    // logging each frame for a render_pipeline to draw on another thread.
+    // m_replica is set on the PPU doing that drawing, which must leave the
+    // (shared) cartridge alone: it reads CHR and mirroring from m_view
+    // instead, as of the logged dot it has reached, through m_view_windows.
+    // m_logged_pages and m_logged_nametables are what the log last recorded
+    // of the cartridge, so only changes get logged.
+    std::unique_ptr<render_pipeline> m_pipeline;
+    frame_log m_log;
+    bool m_logging = false;
+    bool m_replica = false;
+
+    cartridge::ppu_view m_view;
+    std::array<const uint8_t*, mapper::chr_window_count> m_view_windows = {};
+    std::array<uint16_t, mapper::chr_window_count> m_logged_pages = {};
+    std::array<uint16_t, 4> m_logged_nametables = {};
+
+    auto log_access(logged_access::kind type, uint16_t addr, uint16_t value) -> void;
+    auto log_cartridge_changes() -> void;
+    auto point_view_windows() -> void;
+    auto nametable_offset(uint16_t addr) const -> uint16_t;
+    auto apply_accesses(const frame_log& log, size_t& next, uint32_t dot) -> void;
+    auto current_dot() const -> uint32_t;
+
+    auto begin_frame() -> void;
+    auto mark_dirty() -> void;
+    auto mark_raster_activity() -> void;
+    auto stop_reusing_frame() -> void;
+
+    // One table lookup per dot says what to do on it (see ppu.cpp)
+    auto clock() -> void;
+    auto scroll(uint16_t actions) -> void;
+    auto count_scanline_edge() -> void;
 
   public:
+    static const int frame_skip_auto = -1;
 
     ppu();
+    ~ppu();
     auto connect_cartridge(std::shared_ptr<cartridge>& cart) -> void;
+    auto connect_frame_buffer(std::shared_ptr<frame_buffer>& frames) -> void;
     auto reset() -> void;
     auto step() -> void;
 
@@ -211,6 +391,33 @@ class ppu
 
     auto oam_write(uint8_t index, uint8_t byte) -> void;
 
+    auto set_frame_skip(int frames) -> void;
+    auto set_behind_schedule(bool behind) -> void;
+    auto frame_count() const -> uint64_t;
+    auto static_frames() const -> uint64_t;
+
+    // For state the PPU can't see change by itself, like mapper CHR banking
+    auto invalidate_frame() -> void;
+
+    // Moves pixel output to a worker thread (needs the cartridge and frame
+    // buffer connected first), which can in turn split each frame into bands
+    // of scanlines across band_workers more threads
+    auto set_pipelined(bool pipelined, int band_workers = 0) -> void;
+
+    auto save_state(snapshot& state) const -> void;
+    auto load_state(const snapshot& state) -> void;
+
+    // Redraws a logged frame; only for a replica PPU
+    auto replay(const frame_log& log) -> void;
+
+    // For scanline_renderer: advance_to() runs only the scroll side of a
+    // logged frame (v, t and the accesses) up to a dot, so its state there
+    // can be saved as a band's starting point; draw_lines() picks up from
+    // such a state and draws up to last_line into the frame buffer's back
+    // slot
+    auto advance_to(const frame_log& log, size_t& next, uint32_t dot) -> void;
+    auto draw_lines(const frame_log& log, const snapshot& start, int last_line, frame_buffer& frames) -> void;
+
     auto nonmask() -> bool;
     auto interr() -> bool;
 };
@@ -0,0 +1,264 @@
+#include "presenter.hpp"
+
+#include "utils.hpp"
+
+presenter::presenter(int window_width, int window_height, bool software_surface)
+{
+    if (software_surface)
+    {
+        // Otherwise SDL may back the window surface with a renderer and
+        // texture of its own, which is what this mode is avoiding
+        SDL_SetHint(SDL_HINT_FRAMEBUFFER_ACCELERATION, "0");
+
+        init_window(m_window, window_width, window_height);
+        m_blitter = std::make_unique<surface_blitter>(filter_pool());
+    }
+    else
+    {
+        init(m_window, m_renderer, window_width, window_height);
+        create_texture(frame_buffer::width, frame_buffer::height);
+    }
+}
+
+auto presenter::create_texture(int width, int height) -> void
+{
+    m_render_target =
+        std::shared_ptr<SDL_Texture>(SDL_CreateTexture(&*m_renderer,
+                                                       SDL_PIXELFORMAT_ARGB8888,
+                                                       SDL_TEXTUREACCESS_STREAMING,
+                                                       width,
+                                                       height),
+                                     SDL_DestroyTexture);
+}
+
+auto presenter::filter_pool() -> thread_pool&
+{
+    if (m_filter_pool == nullptr)
+    {
+        m_filter_pool = std::make_unique<thread_pool>(filter_workers);
+    }
+
+    return *m_filter_pool;
+}
+
+auto presenter::enable_ntsc_filter(int scale) -> void
+{
+    m_upscaler = nullptr;
+    m_ntsc = std::make_unique<ntsc_filter>(scale, filter_pool());
+
+    if (m_blitter != nullptr)
+    {
+        m_filtered.assign(m_ntsc->width() * m_ntsc->height(), 0);
+        fit_window(scale);
+    }
+    else
+    {
+        create_texture(m_ntsc->width(), m_ntsc->height());
+    }
+}
+
+auto presenter::enable_upscaler(upscaler::kind type) -> void
+{
+    m_ntsc = nullptr;
+    m_upscaler = std::make_unique<upscaler>(type, filter_pool());
+
+    if (m_blitter != nullptr)
+    {
+        m_filtered.assign(m_upscaler->width() * m_upscaler->height(), 0);
+        fit_window(m_upscaler->scale());
+    }
+    else
+    {
+        create_texture(m_upscaler->width(), m_upscaler->height());
+    }
+}
+
+auto presenter::fit_window(int scale) -> void
+{
+    // The surface is only ever scaled up by whole numbers, so the window has
+    // to be at least as big as the filter's picture
+    int width = frame_buffer::width * scale;
+    int height = frame_buffer::height * scale;
+
+    SDL_SetWindowMinimumSize(&*m_window, width, height);
+    SDL_SetWindowSize(&*m_window, width, height);
+}
+
+auto presenter::connect_frame_buffer(std::shared_ptr<frame_buffer>& frames) -> void
+{
+    m_frames = frames;
+
+    // The upscalers only take ARGB, so index frames get expanded into here
+    // first
+    if (m_frames->format() == frame_buffer::palette_index)
+    {
+        m_converted.assign(frame_buffer::pixel_count, 0);
+    }
+}
+
+auto presenter::clear() -> void
+{
+    // In surface mode the blitter clears the borders itself when it first
+    // draws
+    if (m_blitter == nullptr)
+    {
+        SDL_SetRenderTarget(&*m_renderer, &*m_render_target);
+        SDL_SetRenderDrawColor(&*m_renderer, 0x00, 0x00, 0x00, 0xFF);
+        SDL_RenderFillRect(&*m_renderer, nullptr);
+        SDL_SetRenderTarget(&*m_renderer, nullptr);
+        SDL_RenderCopy(&*m_renderer, &*m_render_target, nullptr, nullptr);
+        SDL_RenderPresent(&*m_renderer);
+    }
+}
+
+auto presenter::present() -> bool
+{
+    bool presented = false;
+
+    // Only redraw when the PPU has handed over a frame we haven't shown yet
+    if (m_frames != nullptr and m_frames->acquire())
+    {
+        if (m_blitter != nullptr)
+        {
+            present_to_surface();
+        }
+        else
+        {
+            present_to_texture();
+        }
+        presented = true;
+    }
+
+    return presented;
+}
+
+auto presenter::present_to_texture() -> void
+{
+    SDL_Rect src_rect = {0, 0, frame_buffer::width, frame_buffer::height};
+
+    bool indexed = m_frames->format() == frame_buffer::palette_index;
+
+    if (m_ntsc != nullptr)
+    {
+        // Filter straight into the texture's memory
+        void* pixels = nullptr;
+        int pitch = 0;
+        if (SDL_LockTexture(&*m_render_target, nullptr, &pixels, &pitch) == 0)
+        {
+            m_ntsc->apply(m_frames->front_indices(),
+                          m_frames->front_emphasis(),
+                          static_cast<uint32_t*>(pixels),
+                          pitch);
+            SDL_UnlockTexture(&*m_render_target);
+        }
+        src_rect.w = m_ntsc->width();
+    }
+    else if (m_upscaler != nullptr)
+    {
+        const uint32_t* source = m_frames->front();
+        if (indexed)
+        {
+            palette::to_argb(m_frames->front_indices(),
+                             m_frames->front_emphasis(),
+                             m_converted.data(),
+                             frame_buffer::pitch);
+            source = m_converted.data();
+        }
+
+        void* pixels = nullptr;
+        int pitch = 0;
+        if (SDL_LockTexture(&*m_render_target, nullptr, &pixels, &pitch) == 0)
+        {
+            m_upscaler->apply(source, static_cast<uint32_t*>(pixels), pitch);
+            SDL_UnlockTexture(&*m_render_target);
+        }
+        src_rect.w = m_upscaler->width();
+        src_rect.h = m_upscaler->height();
+    }
+    else if (indexed)
+    {
+        // Expand the indices straight into the texture's memory
+        void* pixels = nullptr;
+        int pitch = 0;
+        if (SDL_LockTexture(&*m_render_target, nullptr, &pixels, &pitch) == 0)
+        {
+            palette::to_argb(m_frames->front_indices(),
+                             m_frames->front_emphasis(),
+                             static_cast<uint32_t*>(pixels),
+                             pitch);
+            SDL_UnlockTexture(&*m_render_target);
+        }
+    }
+    else
+    {
+        SDL_UpdateTexture(&*m_render_target, nullptr, m_frames->front(), frame_buffer::pitch);
+    }
+
+    SDL_SetRenderTarget(&*m_renderer, nullptr);
+    SDL_RenderCopy(&*m_renderer, &*m_render_target, &src_rect, nullptr);
+    SDL_RenderPresent(&*m_renderer);
+}
+
+auto presenter::present_to_surface() -> void
+{
+    // The surface is replaced whenever the window is resized, so it's fetched
+    // every time
+    SDL_Surface* surface = SDL_GetWindowSurface(&*m_window);
+
+    if (surface == nullptr)
+    {
+        printf("Window surface unavailable! SDL Error: %s\n", SDL_GetError());
+    }
+    else if (!SDL_MUSTLOCK(surface) or SDL_LockSurface(surface) == 0)
+    {
+        surface_blitter::target out = {surface->pixels,
+                                       surface->pitch,
+                                       surface->w,
+                                       surface->h,
+                                       surface->format->BytesPerPixel,
+                                       surface->format->Rmask,
+                                       surface->format->Gmask,
+                                       surface->format->Bmask};
+
+        bool indexed = m_frames->format() == frame_buffer::palette_index;
+
+        if (m_ntsc != nullptr)
+        {
+            m_ntsc->apply(m_frames->front_indices(),
+                          m_frames->front_emphasis(),
+                          m_filtered.data(),
+                          m_ntsc->width() * sizeof(uint32_t));
+            m_blitter->apply(m_filtered.data(), m_ntsc->width(), m_ntsc->height(), out);
+        }
+        else if (m_upscaler != nullptr)
+        {
+            const uint32_t* source = m_frames->front();
+            if (indexed)
+            {
+                palette::to_argb(m_frames->front_indices(),
+                                 m_frames->front_emphasis(),
+                                 m_converted.data(),
+                                 frame_buffer::pitch);
+                source = m_converted.data();
+            }
+
+            m_upscaler->apply(source, m_filtered.data(), m_upscaler->width() * sizeof(uint32_t));
+            m_blitter->apply(m_filtered.data(), m_upscaler->width(), m_upscaler->height(), out);
+        }
+        else if (indexed)
+        {
+            m_blitter->apply(m_frames->front_indices(), m_frames->front_emphasis(), out);
+        }
+        else
+        {
+            m_blitter->apply(m_frames->front(), frame_buffer::width, frame_buffer::height, out);
+        }
+
+        if (SDL_MUSTLOCK(surface))
+        {
+            SDL_UnlockSurface(surface);
+        }
+
+        SDL_UpdateWindowSurface(&*m_window);
+    }
+}
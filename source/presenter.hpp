@@ -0,0 +1,61 @@
+#ifndef CYGNES_PRESENTER_HPP
+#define CYGNES_PRESENTER_HPP
+
+#include <memory>
+#include <vector>
+
+#include "SDL.h"
+#include "frame_buffer.hpp"
+#include "ntsc_filter.hpp"
+#include "palette.hpp"
+#include "surface_blitter.hpp"
+#include "thread_pool.hpp"
+#include "upscaler.hpp"
+
+/*
+ * Owns the window and renderer, and puts whatever frame the PPU last finished
+ * on screen. Lives on the thread that created the window (SDL wants window
+ * events and rendering to stay there), while the emulation runs elsewhere.
+ *
+ * With software_surface set there's no renderer at all: frames are drawn
+ * straight into the window surface by a surface_blitter, which suits hosts
+ * without a GPU better than SDL's software renderer.
+ */
+class presenter
+{
+    std::shared_ptr<SDL_Window> m_window;
+    std::shared_ptr<SDL_Renderer> m_renderer;
+    std::shared_ptr<SDL_Texture> m_render_target;
+
+    std::shared_ptr<frame_buffer> m_frames = nullptr;
+
+    // Optional composite video filter, fed from palette-index frames, or a
+    // pixel-art upscaler fed from ARGB frames; both share the worker threads
+    static constexpr int filter_workers = 2;
+    std::unique_ptr<thread_pool> m_filter_pool;
+    std::unique_ptr<ntsc_filter> m_ntsc;
+    std::unique_ptr<upscaler> m_upscaler;
+    std::vector<uint32_t> m_converted;
+
+    // Software surface mode; m_filtered holds the NTSC filter's or an
+    // upscaler's output on its way to the surface
+    std::unique_ptr<surface_blitter> m_blitter;
+    std::vector<uint32_t> m_filtered;
+
+    auto create_texture(int width, int height) -> void;
+    auto filter_pool() -> thread_pool&;
+    auto fit_window(int scale) -> void;
+    auto present_to_texture() -> void;
+    auto present_to_surface() -> void;
+
+  public:
+    presenter(int window_width, int window_height, bool software_surface = false);
+
+    auto connect_frame_buffer(std::shared_ptr<frame_buffer>& frames) -> void;
+    auto enable_ntsc_filter(int scale) -> void;
+    auto enable_upscaler(upscaler::kind type) -> void;
+    auto clear() -> void;
+    auto present() -> bool;
+};
+
+#endif  // CYGNES_PRESENTER_HPP
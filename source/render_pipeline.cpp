@@ -0,0 +1,74 @@
+#include "render_pipeline.hpp"
+
+#include <utility>
+
+render_pipeline::render_pipeline(std::shared_ptr<frame_buffer>& frames, int band_workers)
+    : m_frames(frames)
+{
+    // The renderers draw from the views in the logs, never the cartridge
+    m_renderer.connect_frame_buffer(frames);
+
+    if (band_workers > 0)
+    {
+        m_band_pool = std::make_unique<thread_pool>(band_workers);
+        m_bands = std::make_unique<scanline_renderer>(*m_band_pool);
+    }
+
+    m_worker = std::thread(&render_pipeline::worker_loop, this);
+}
+
+render_pipeline::~render_pipeline()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_changed.notify_all();
+    m_worker.join();
+}
+
+auto render_pipeline::submit(ppu::frame_log& log) -> void
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_changed.wait(lock, [this]() { return !m_has_pending; });
+
+        std::swap(m_pending, log);
+        m_has_pending = true;
+    }
+    m_changed.notify_all();
+
+    log.accesses.clear();
+}
+
+auto render_pipeline::worker_loop() -> void
+{
+    ppu::frame_log current;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_changed.wait(lock, [this]() { return m_has_pending or m_stopping; });
+
+            // Finish the last frame handed over before stopping
+            if (!m_has_pending)
+            {
+                break;
+            }
+
+            std::swap(current, m_pending);
+            m_has_pending = false;
+        }
+        m_changed.notify_all();
+
+        if (m_bands != nullptr)
+        {
+            m_bands->render(current, *m_frames);
+        }
+        else
+        {
+            m_renderer.replay(current);
+        }
+    }
+}
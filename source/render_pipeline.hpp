@@ -0,0 +1,63 @@
+#ifndef CYGNES_RENDER_PIPELINE_HPP
+#define CYGNES_RENDER_PIPELINE_HPP
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "frame_buffer.hpp"
+#include "ppu.hpp"
+#include "scanline_renderer.hpp"
+#include "thread_pool.hpp"
+
+/*
+ * Draws frames on a worker thread from the logs a timing-only PPU keeps on
+ * the emulation thread, so drawing frame N overlaps emulating frame N + 1.
+ *
+ * The worker owns a second PPU that starts each frame from the logged
+ * snapshot and replays the register writes, register reads, OAM DMA and
+ * mapper bank switches at the dots they happened at, which makes its output
+ * identical to drawing in place. It draws from the cartridge's CHR and
+ * mirroring as the log recorded them, never from the cartridge itself. Status bits and vblank timing never leave the emulation thread,
+ * since the timing-only PPU still runs the full fetch schedule.
+ *
+ * With band workers, each frame is instead split into bands of scanlines
+ * drawn in parallel by a scanline_renderer, which cuts the latency of a
+ * frame at the cost of static-frame detection.
+ *
+ * At most one finished log waits for the worker; if the worker is still
+ * busy when the next frame finishes, submit() waits rather than drop it,
+ * and a log already handed over still gets drawn on shutdown.
+ */
+class render_pipeline
+{
+    ppu m_renderer;
+    std::shared_ptr<frame_buffer> m_frames;
+    std::unique_ptr<thread_pool> m_band_pool;
+    std::unique_ptr<scanline_renderer> m_bands;
+
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+
+    ppu::frame_log m_pending;
+    bool m_has_pending = false;
+    bool m_stopping = false;
+
+    std::thread m_worker;
+
+    auto worker_loop() -> void;
+
+  public:
+    render_pipeline(std::shared_ptr<frame_buffer>& frames, int band_workers);
+    ~render_pipeline();
+
+    render_pipeline(const render_pipeline&) = delete;
+    auto operator=(const render_pipeline&) -> render_pipeline& = delete;
+
+    // Takes a finished frame's log, leaving an emptied one (with its capacity)
+    // in its place for the next frame
+    auto submit(ppu::frame_log& log) -> void;
+};
+
+#endif  // CYGNES_RENDER_PIPELINE_HPP
@@ -0,0 +1,221 @@
+#include "rom_image.hpp"
+
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+struct image_cache
+{
+    std::mutex mutex;
+    std::unordered_multimap<uint64_t, std::weak_ptr<const rom_image>> images;
+};
+
+auto cache() -> image_cache&
+{
+    static image_cache instance;
+    return instance;
+}
+
+// Four independent multiply-xorshift lanes over 8-byte words, so hashing a
+// large ROM is limited by memory bandwidth rather than multiply latency
+auto content_hash(const uint8_t* data, size_t size) -> uint64_t
+{
+    const uint64_t multiplier = 0xFF51AFD7ED558CCD;
+    uint64_t lanes[4] = {0x9E3779B97F4A7C15, 0xC2B2AE3D27D4EB4F, 0x165667B19E3779F9, 0x27D4EB2F165667C5};
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            uint64_t word;
+            memcpy(&word, data + i + lane * 8, sizeof(word));
+            lanes[lane] = (lanes[lane] ^ word) * multiplier;
+            lanes[lane] ^= lanes[lane] >> 32;
+        }
+    }
+
+    uint64_t hash = size;
+    for (uint64_t lane : lanes)
+    {
+        hash = (hash ^ lane) * multiplier;
+        hash ^= hash >> 29;
+    }
+    for (; i < size; ++i)
+    {
+        hash = (hash ^ data[i]) * 0x100000001B3;
+    }
+
+    return hash;
+}
+}  // namespace
+
+auto rom_image::open(const std::string& rom_path) -> std::shared_ptr<const rom_image>
+{
+    std::shared_ptr<const rom_image> image = nullptr;
+
+    image_cache& images = cache();
+    std::lock_guard<std::mutex> lock(images.mutex);
+
+    // The same file, not touched since it was loaded, needn't be read at all
+    file_identity identity = {};
+    if (identify(rom_path, identity))
+    {
+        for (auto it = images.images.begin(); it != images.images.end() and image == nullptr; ++it)
+        {
+            std::shared_ptr<const rom_image> cached = it->second.lock();
+            if (cached != nullptr and cached->m_identity == identity)
+            {
+                image = cached;
+            }
+        }
+    }
+
+    mapped_file file;
+    if (image == nullptr and !file.open(rom_path))
+    {
+        printf("ERROR: Invalid ROM file! (check file name / path)\n");
+    }
+    else if (image == nullptr)
+    {
+        uint64_t hash = content_hash(file.data(), file.size());
+
+        // The hash only narrows it down; the contents have to match too
+        auto [first, last] = images.images.equal_range(hash);
+        for (auto it = first; it != last and image == nullptr; ++it)
+        {
+            std::shared_ptr<const rom_image> cached = it->second.lock();
+            if (cached != nullptr
+                and cached->m_file.size() == file.size()
+                and memcmp(cached->m_file.data(), file.data(), file.size()) == 0)
+            {
+                image = cached;
+            }
+        }
+
+        if (image == nullptr)
+        {
+            std::shared_ptr<rom_image> loaded(new rom_image());
+            loaded->m_file = std::move(file);
+            loaded->m_identity = identity;
+
+            if (loaded->parse(rom_path))
+            {
+                // Drop whatever images have gone since the last load
+                for (auto it = images.images.begin(); it != images.images.end();)
+                {
+                    it = it->second.expired() ? images.images.erase(it) : std::next(it);
+                }
+
+                images.images.emplace(hash, loaded);
+                image = loaded;
+            }
+        }
+    }
+
+    return image;
+}
+
+auto rom_image::cached_count() -> int
+{
+    image_cache& images = cache();
+    std::lock_guard<std::mutex> lock(images.mutex);
+
+    int count = 0;
+    for (auto& entry : images.images)
+    {
+        count += entry.second.expired() ? 0 : 1;
+    }
+
+    return count;
+}
+
+auto rom_image::identify(const std::string& rom_path, file_identity& identity) -> bool
+{
+    bool success = false;
+
+    struct stat info = {};
+    if (stat(rom_path.c_str(), &info) == 0)
+    {
+        identity.device = info.st_dev;
+        identity.inode = info.st_ino;
+        identity.size = info.st_size;
+#ifdef __APPLE__
+        const timespec& modified = info.st_mtimespec;
+#else
+        const timespec& modified = info.st_mtim;
+#endif
+        identity.modified_ns = static_cast<int64_t>(modified.tv_sec) * 1000000000 + modified.tv_nsec;
+        success = true;
+    }
+
+    return success;
+}
+
+auto rom_image::file_identity::operator==(const file_identity& other) const -> bool
+{
+    return device == other.device
+           and inode == other.inode
+           and size == other.size
+           and modified_ns == other.modified_ns;
+}
+
+auto rom_image::parse(const std::string& rom_path) -> bool
+{
+    bool load_success = m_file.size() >= ines_header::size and m_header.decode(m_file.data());
+
+    if (!load_success)
+    {
+        printf("ERROR: %s is not an iNES file\n", rom_path.c_str());
+    }
+    else
+    {
+        // ROM sizes are checked against the file before anything narrows
+        // them to int, which also keeps absurd NES 2.0 sizes out
+        uint64_t rom_end = m_header.prg_rom_offset() + m_header.prg_rom_size + m_header.chr_rom_size;
+        if (m_header.prg_rom_size == 0 or m_header.prg_rom_size > INT32_MAX or m_header.chr_rom_size > INT32_MAX
+            or rom_end > m_file.size())
+        {
+            printf("ERROR: ROM file is %zu bytes, too short for what its header describes\n", m_file.size());
+            load_success = false;
+        }
+    }
+
+    if (load_success)
+    {
+        m_prg_rom = m_file.data() + m_header.prg_rom_offset();
+        m_chr_rom = m_prg_rom + m_header.prg_rom_size;
+    }
+
+    return load_success;
+}
+
+auto rom_image::prg_rom() const -> const uint8_t*
+{
+    return m_prg_rom;
+}
+
+auto rom_image::prg_rom_size() const -> int
+{
+    return static_cast<int>(m_header.prg_rom_size);
+}
+
+auto rom_image::chr_rom() const -> const uint8_t*
+{
+    return m_chr_rom;
+}
+
+auto rom_image::chr_rom_size() const -> int
+{
+    return static_cast<int>(m_header.chr_rom_size);
+}
+
+auto rom_image::header() const -> const ines_header&
+{
+    return m_header;
+}
@@ -0,0 +1,66 @@
+#ifndef CYGNES_ROM_IMAGE_HPP
+#define CYGNES_ROM_IMAGE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "ines_header.hpp"
+#include "mapped_file.hpp"
+
+/*
+ * A parsed iNES or NES 2.0 file: its header, and PRG and CHR-ROM as views into
+ * the mapped file. Images never change once loaded, so every cartridge
+ * running the same game shares one, and keeps only its own RAM and bank
+ * registers.
+ *
+ * open() goes through a process-wide cache keyed by a hash of the file's
+ * contents (the same ROM under two names is still one image). Opening a file
+ * that's already loaded and unchanged skips even that, going by its inode and
+ * modification time. The cache only holds weak references: an image goes
+ * away with the last cartridge using it.
+ */
+class rom_image
+{
+    // Which file on disk, as of which change, the image came from
+    struct file_identity
+    {
+        uint64_t device;
+        uint64_t inode;
+        int64_t size;
+        int64_t modified_ns;
+
+        auto operator==(const file_identity& other) const -> bool;
+    };
+
+    mapped_file m_file;
+    file_identity m_identity = {};
+    ines_header m_header;
+
+    const uint8_t* m_prg_rom = nullptr;
+    const uint8_t* m_chr_rom = nullptr;
+
+    rom_image() = default;
+
+    auto parse(const std::string& rom_path) -> bool;
+
+    static auto identify(const std::string& rom_path, file_identity& identity) -> bool;
+
+  public:
+    // nullptr if the file can't be read or isn't a ROM we understand
+    static auto open(const std::string& rom_path) -> std::shared_ptr<const rom_image>;
+
+    // How many distinct images are loaded right now
+    static auto cached_count() -> int;
+
+    auto prg_rom() const -> const uint8_t*;
+    auto prg_rom_size() const -> int;
+
+    // chr_rom_size() is 0 when the cartridge has CHR-RAM instead
+    auto chr_rom() const -> const uint8_t*;
+    auto chr_rom_size() const -> int;
+
+    auto header() const -> const ines_header&;
+};
+
+#endif  // CYGNES_ROM_IMAGE_HPP
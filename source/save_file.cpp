@@ -0,0 +1,161 @@
+#include "save_file.hpp"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+// The one thread that flushes every open save file
+class flusher
+{
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::vector<save_file*> m_saves;
+    std::thread m_thread;
+
+    auto run() -> void
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_wake.wait_for(lock, save_file::flush_interval);
+            for (save_file* save : m_saves)
+            {
+                save->flush();
+            }
+        }
+    }
+
+  public:
+    flusher()
+        : m_thread(&flusher::run, this)
+    {
+
+    }
+
+    auto add(save_file* save) -> void
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_saves.push_back(save);
+    }
+
+    // Once this returns, the thread won't touch save again
+    auto remove(save_file* save) -> void
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_saves.erase(std::remove(m_saves.begin(), m_saves.end(), save), m_saves.end());
+    }
+
+    auto flush_all() -> void
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (save_file* save : m_saves)
+        {
+            save->flush();
+        }
+    }
+};
+
+// Never destroyed, so saves closed during static destruction can still
+// unregister, and the thread never has to be joined; whatever is still open
+// at exit gets one last flush
+auto saves() -> flusher&
+{
+    static flusher* instance = [] {
+        flusher* created = new flusher();
+        std::atexit([] { saves().flush_all(); });
+        return created;
+    }();
+
+    return *instance;
+}
+}  // namespace
+
+save_file::~save_file()
+{
+    close();
+}
+
+auto save_file::open(const std::string& path, size_t size) -> bool
+{
+    bool success = false;
+
+    close();
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd >= 0)
+    {
+        struct stat info = {};
+        if (flock(fd, LOCK_EX | LOCK_NB) == 0
+            and fstat(fd, &info) == 0
+            and (static_cast<size_t>(info.st_size) >= size or ftruncate(fd, static_cast<off_t>(size)) == 0))
+        {
+            void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                m_fd = fd;
+                m_data = static_cast<uint8_t*>(data);
+                m_size = size;
+                m_dirty.store(false, std::memory_order_relaxed);
+                success = true;
+            }
+        }
+
+        // Closing drops the lock too
+        if (!success)
+        {
+            ::close(fd);
+        }
+    }
+
+    if (success)
+    {
+        saves().add(this);
+    }
+
+    return success;
+}
+
+auto save_file::close() -> void
+{
+    if (m_data != nullptr)
+    {
+        saves().remove(this);
+        flush();
+
+        munmap(m_data, m_size);
+        ::close(m_fd);
+
+        m_fd = -1;
+        m_data = nullptr;
+        m_size = 0;
+    }
+}
+
+auto save_file::data() -> uint8_t*
+{
+    return m_data;
+}
+
+auto save_file::size() const -> size_t
+{
+    return m_size;
+}
+
+auto save_file::flush() -> void
+{
+    if (m_dirty.exchange(false, std::memory_order_relaxed))
+    {
+        msync(m_data, m_size, MS_SYNC);
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef CYGNES_SAVE_FILE_HPP
+#define CYGNES_SAVE_FILE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * Battery-backed cartridge RAM kept in a .sav file mapped read-write into
+ * memory, so the game writes straight into the page cache and saving never
+ * costs the emulation any file I/O. Writers call mark_dirty() (a single
+ * relaxed store), and a background thread shared by every save file msyncs
+ * the dirty ones to disk every flush_interval, and again at exit.
+ *
+ * The pages belong to the OS as soon as they're written, so even a crash of
+ * the emulator loses nothing; the flushes are what protect against the
+ * machine itself going down, which can lose at most one interval.
+ *
+ * A save file is locked while it's open: a second cartridge running the same
+ * game in the same (or another) process can't open it, and should run on a
+ * private copy instead.
+ */
+class save_file
+{
+    int m_fd = -1;
+    uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    std::atomic<bool> m_dirty {false};
+
+  public:
+    static constexpr std::chrono::milliseconds flush_interval {1000};
+
+    save_file() = default;
+    ~save_file();
+
+    save_file(const save_file&) = delete;
+    auto operator=(const save_file&) -> save_file& = delete;
+
+    // Creates the file, or grows it to size with zeros, and maps size bytes
+    // of it. Fails if it can't, or if something else has it open.
+    auto open(const std::string& path, size_t size) -> bool;
+    auto close() -> void;
+
+    auto data() -> uint8_t*;
+    auto size() const -> size_t;
+
+    auto mark_dirty() -> void;
+
+    // Writes the pages out now if anything changed since the last flush
+    auto flush() -> void;
+};
+
+inline auto save_file::mark_dirty() -> void
+{
+    m_dirty.store(true, std::memory_order_relaxed);
+}
+
+#endif  // CYGNES_SAVE_FILE_HPP
@@ -0,0 +1,44 @@
+#include "scanline_renderer.hpp"
+
+scanline_renderer::scanline_renderer(thread_pool& pool)
+    : m_pool(pool)
+    , m_band_count(pool.size() * 2)
+{
+    for (int band = 0; band < m_band_count; ++band)
+    {
+        m_band_ppus.push_back(std::make_unique<ppu>());
+    }
+
+    m_band_starts.resize(m_band_count);
+
+    // Band boundaries, as first lines, plus the end of the picture
+    for (int band = 0; band <= m_band_count; ++band)
+    {
+        m_band_lines.push_back(band * frame_buffer::height / m_band_count);
+    }
+}
+
+auto scanline_renderer::render(const ppu::frame_log& log, frame_buffer& frames) -> void
+{
+    // The first band starts where the frame does; the rest start at the tile
+    // prefetch on the line above them
+    m_band_starts[0] = log.start;
+    m_scout.load_state(log.start);
+    size_t next = 0;
+
+    for (int band = 1; band < m_band_count; ++band)
+    {
+        uint32_t dot = (m_band_lines[band] - 1) * ppu::dots_per_line + 321;
+        m_scout.advance_to(log, next, dot);
+        m_scout.save_state(m_band_starts[band]);
+    }
+
+    m_pool.parallel_for(0, m_band_count, [&](int first, int last) {
+        for (int band = first; band < last; ++band)
+        {
+            m_band_ppus[band]->draw_lines(log, m_band_starts[band], m_band_lines[band + 1], frames);
+        }
+    });
+
+    frames.publish();
+}
@@ -0,0 +1,49 @@
+#ifndef CYGNES_SCANLINE_RENDERER_HPP
+#define CYGNES_SCANLINE_RENDERER_HPP
+
+#include <memory>
+#include <vector>
+
+#include "frame_buffer.hpp"
+#include "ppu.hpp"
+#include "thread_pool.hpp"
+
+/*
+ * Draws a logged frame (see ppu::frame_log) in bands of scanlines on a
+ * thread pool, for when a frame's latency matters more than its cost: big
+ * filtered output or offline video export.
+ *
+ * A line's pixels only depend on the PPU's state as it starts the line. A
+ * quick sequential pass steps just the scroll logic (inc_x/inc_y/copy_x/
+ * copy_y) and the logged accesses to find that state at the start of each
+ * band, without fetching or drawing anything. Each band then gets its own
+ * PPU, which starts at the previous line's tile prefetch (dot 321) and draws
+ * through the band exactly as the real one would.
+ *
+ * The scout applies the logged bank switches and CHR-RAM writes too, so each
+ * band's starting state carries the CHR banks, mirroring and CHR-RAM as of
+ * its first line. None of these PPUs touches the cartridge.
+ *
+ * The one thing this can't reproduce is background rendering being off
+ * during the prefetch dots and switched on before the next line, where the
+ * hardware shows whatever was left in its shifters.
+ */
+class scanline_renderer
+{
+    thread_pool& m_pool;
+    int m_band_count;
+
+    // Steps the scroll pass; one drawing PPU and starting state per band
+    ppu m_scout;
+    std::vector<std::unique_ptr<ppu>> m_band_ppus;
+    std::vector<ppu::snapshot> m_band_starts;
+    std::vector<int> m_band_lines;
+
+  public:
+    explicit scanline_renderer(thread_pool& pool);
+
+    // Draws the frame into the back slot of frames and publishes it
+    auto render(const ppu::frame_log& log, frame_buffer& frames) -> void;
+};
+
+#endif  // CYGNES_SCANLINE_RENDERER_HPP
@@ -0,0 +1,337 @@
+#include "surface_blitter.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "palette.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define CYGNES_SURFACE_BLITTER_SSE2 1
+#endif
+
+namespace
+{
+    auto channel_value(uint32_t value, int shift, int bits) -> uint32_t
+    {
+        uint32_t scaled = 0;
+
+        if (bits > 8)
+        {
+            scaled = value << (bits - 8);
+        }
+        else if (bits > 0)
+        {
+            scaled = value >> (8 - bits);
+        }
+
+        return scaled << shift;
+    }
+
+    // Writes each pixel scale times over
+    auto widen32(const uint32_t* line, uint32_t* out, int count, int scale) -> void
+    {
+        int x = 0;
+
+#ifdef CYGNES_SURFACE_BLITTER_SSE2
+        if (scale == 2)
+        {
+            for (; x + 4 <= count; x += 4)
+            {
+                __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + x));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 2), _mm_unpacklo_epi32(pixels, pixels));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 2 + 4), _mm_unpackhi_epi32(pixels, pixels));
+            }
+        }
+        else if (scale == 3)
+        {
+            for (; x + 4 <= count; x += 4)
+            {
+                __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + x));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 3), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(1, 0, 0, 0)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 3 + 4), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(2, 2, 1, 1)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 3 + 8), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(3, 3, 3, 2)));
+            }
+        }
+        else if (scale == 4)
+        {
+            for (; x + 4 <= count; x += 4)
+            {
+                __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + x));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(0, 0, 0, 0)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4 + 4), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(1, 1, 1, 1)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4 + 8), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(2, 2, 2, 2)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4 + 12), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(3, 3, 3, 3)));
+            }
+        }
+#endif
+
+        if (scale == 1)
+        {
+            std::memcpy(out, line, count * sizeof(uint32_t));
+        }
+        else
+        {
+            for (; x < count; ++x)
+            {
+                std::fill_n(out + x * scale, scale, line[x]);
+            }
+        }
+    }
+
+    auto widen16(const uint32_t* line, uint16_t* out, int count, int scale) -> void
+    {
+        int x = 0;
+
+#ifdef CYGNES_SURFACE_BLITTER_SSE2
+        if (scale == 2 or scale == 4)
+        {
+            // Eight 16-bit pixels at a time: each is copied into both halves
+            // of a 32-bit lane, which for 2x is the finished output
+            const __m128i bias = _mm_set1_epi32(0x8000);
+            const __m128i unbias = _mm_set1_epi16(static_cast<short>(0x8000));
+
+            for (; x + 8 <= count; x += 8)
+            {
+                __m128i low = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line + x)), bias);
+                __m128i high = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line + x + 4)), bias);
+                __m128i pixels = _mm_xor_si128(_mm_packs_epi32(low, high), unbias);
+                __m128i doubled_low = _mm_unpacklo_epi16(pixels, pixels);
+                __m128i doubled_high = _mm_unpackhi_epi16(pixels, pixels);
+
+                if (scale == 2)
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 2), doubled_low);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 2 + 8), doubled_high);
+                }
+                else
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4), _mm_unpacklo_epi32(doubled_low, doubled_low));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4 + 8), _mm_unpackhi_epi32(doubled_low, doubled_low));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4 + 16), _mm_unpacklo_epi32(doubled_high, doubled_high));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4 + 24), _mm_unpackhi_epi32(doubled_high, doubled_high));
+                }
+            }
+        }
+#endif
+
+        if (scale == 3)
+        {
+            for (; x < count; ++x)
+            {
+                uint16_t pixel = static_cast<uint16_t>(line[x]);
+                out[x * 3] = pixel;
+                out[x * 3 + 1] = pixel;
+                out[x * 3 + 2] = pixel;
+            }
+        }
+        else
+        {
+            for (; x < count; ++x)
+            {
+                std::fill_n(out + x * scale, scale, static_cast<uint16_t>(line[x]));
+            }
+        }
+    }
+}
+
+surface_blitter::surface_blitter(thread_pool& pool)
+    : m_pool(pool)
+{
+}
+
+auto surface_blitter::placement::operator==(const placement& other) const -> bool
+{
+    return scale_x == other.scale_x
+        and scale_y == other.scale_y
+        and columns == other.columns
+        and rows == other.rows
+        and left == other.left
+        and top == other.top;
+}
+
+auto surface_blitter::supports(const target& out) -> bool
+{
+    return out.pixels != nullptr and (out.bytes_per_pixel == 2 or out.bytes_per_pixel == 4);
+}
+
+auto surface_blitter::fit(const target& out, int width, int height) -> placement
+{
+    placement place = {};
+
+    // The scale is picked in NES pixels, so a source that's been scaled
+    // already (or, like the NTSC filter's, only widened) keeps the picture's
+    // shape as far as whole numbers allow. Anything too big is cropped.
+    int scale = std::max(1, std::min(out.width / frame_buffer::width, out.height / frame_buffer::height));
+
+    place.scale_x = std::max(1, scale * frame_buffer::width / width);
+    place.scale_y = std::max(1, scale * frame_buffer::height / height);
+    place.columns = std::min(width, out.width / place.scale_x);
+    place.rows = std::min(height, out.height / place.scale_y);
+    place.left = (out.width - place.columns * place.scale_x) / 2;
+    place.top = (out.height - place.rows * place.scale_y) / 2;
+
+    return place;
+}
+
+auto surface_blitter::prepare(const target& out, const placement& place) -> void
+{
+    if (out.bytes_per_pixel != m_format.bytes_per_pixel
+        or out.red_mask != m_format.red_mask
+        or out.green_mask != m_format.green_mask
+        or out.blue_mask != m_format.blue_mask)
+    {
+        m_format = out;
+        m_red = {__builtin_ctz(out.red_mask | 0x80000000), __builtin_popcount(out.red_mask)};
+        m_green = {__builtin_ctz(out.green_mask | 0x80000000), __builtin_popcount(out.green_mask)};
+        m_blue = {__builtin_ctz(out.blue_mask | 0x80000000), __builtin_popcount(out.blue_mask)};
+
+        m_simd_channels = m_red.bits >= 1 and m_red.bits <= 8
+            and m_green.bits >= 1 and m_green.bits <= 8
+            and m_blue.bits >= 1 and m_blue.bits <= 8;
+        m_xrgb = out.bytes_per_pixel == 4
+            and out.red_mask == 0xFF0000 and out.green_mask == 0x00FF00 and out.blue_mask == 0x0000FF;
+
+        m_palette.resize(palette::index_count);
+        for (int i = 0; i < palette::index_count; ++i)
+        {
+            m_palette[i] = convert(palette::argb()[i]);
+        }
+    }
+
+    // Borders are black, whatever the format
+    if (out.pixels != m_drawn_on.pixels
+        or out.pitch != m_drawn_on.pitch
+        or out.width != m_drawn_on.width
+        or out.height != m_drawn_on.height
+        or !(place == m_drawn))
+    {
+        for (int y = 0; y < out.height; ++y)
+        {
+            std::memset(static_cast<uint8_t*>(out.pixels) + static_cast<ptrdiff_t>(y) * out.pitch, 0, out.width * out.bytes_per_pixel);
+        }
+
+        m_drawn_on = out;
+        m_drawn = place;
+    }
+}
+
+auto surface_blitter::convert(uint32_t argb) const -> uint32_t
+{
+    return channel_value((argb >> 16) & 0xFF, m_red.shift, m_red.bits)
+        | channel_value((argb >> 8) & 0xFF, m_green.shift, m_green.bits)
+        | channel_value(argb & 0xFF, m_blue.shift, m_blue.bits);
+}
+
+auto surface_blitter::convert_row(const uint32_t* in, uint32_t* out, int count) const -> void
+{
+    int x = 0;
+
+#ifdef CYGNES_SURFACE_BLITTER_SSE2
+    if (m_simd_channels)
+    {
+        // Each channel's top bits are shifted down to bit 0, masked, and
+        // shifted up to where the surface wants them
+        const __m128i red_mask = _mm_set1_epi32((1 << m_red.bits) - 1);
+        const __m128i green_mask = _mm_set1_epi32((1 << m_green.bits) - 1);
+        const __m128i blue_mask = _mm_set1_epi32((1 << m_blue.bits) - 1);
+        const __m128i red_down = _mm_cvtsi32_si128(24 - m_red.bits);
+        const __m128i green_down = _mm_cvtsi32_si128(16 - m_green.bits);
+        const __m128i blue_down = _mm_cvtsi32_si128(8 - m_blue.bits);
+        const __m128i red_up = _mm_cvtsi32_si128(m_red.shift);
+        const __m128i green_up = _mm_cvtsi32_si128(m_green.shift);
+        const __m128i blue_up = _mm_cvtsi32_si128(m_blue.shift);
+
+        for (; x + 4 <= count; x += 4)
+        {
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x));
+            __m128i red = _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(pixels, red_down), red_mask), red_up);
+            __m128i green = _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(pixels, green_down), green_mask), green_up);
+            __m128i blue = _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(pixels, blue_down), blue_mask), blue_up);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_or_si128(_mm_or_si128(red, green), blue));
+        }
+    }
+#endif
+
+    for (; x < count; ++x)
+    {
+        out[x] = convert(in[x]);
+    }
+}
+
+auto surface_blitter::write_row(const uint32_t* line, const target& out, const placement& place, int row) const -> void
+{
+    uint8_t* first = static_cast<uint8_t*>(out.pixels)
+        + static_cast<ptrdiff_t>(place.top + row * place.scale_y) * out.pitch
+        + place.left * out.bytes_per_pixel;
+
+    if (out.bytes_per_pixel == 4)
+    {
+        widen32(line, reinterpret_cast<uint32_t*>(first), place.columns, place.scale_x);
+    }
+    else
+    {
+        widen16(line, reinterpret_cast<uint16_t*>(first), place.columns, place.scale_x);
+    }
+
+    // The rest of the row's height are straight copies
+    for (int copy = 1; copy < place.scale_y; ++copy)
+    {
+        std::memcpy(first + static_cast<ptrdiff_t>(copy) * out.pitch, first, place.columns * place.scale_x * out.bytes_per_pixel);
+    }
+}
+
+auto surface_blitter::apply(const uint32_t* in, int width, int height, const target& out) -> void
+{
+    if (supports(out))
+    {
+        placement place = fit(out, width, height);
+        prepare(out, place);
+
+        m_pool.parallel_for(0, place.rows, [&](int first, int last) {
+            std::vector<uint32_t> line(place.columns);
+
+            for (int y = first; y < last; ++y)
+            {
+                const uint32_t* row = in + static_cast<ptrdiff_t>(y) * width;
+
+                if (m_xrgb)
+                {
+                    write_row(row, out, place, y);
+                }
+                else
+                {
+                    convert_row(row, line.data(), place.columns);
+                    write_row(line.data(), out, place, y);
+                }
+            }
+        });
+    }
+}
+
+auto surface_blitter::apply(const uint8_t* indices, const uint8_t* emphasis, const target& out) -> void
+{
+    if (supports(out))
+    {
+        placement place = fit(out, frame_buffer::width, frame_buffer::height);
+        prepare(out, place);
+
+        m_pool.parallel_for(0, place.rows, [&](int first, int last) {
+            std::vector<uint32_t> line(place.columns);
+
+            for (int y = first; y < last; ++y)
+            {
+                const uint32_t* lookup = m_palette.data() + (emphasis[y] & 0x07) * palette::color_count;
+                const uint8_t* row = indices + y * frame_buffer::width;
+
+                for (int x = 0; x < place.columns; ++x)
+                {
+                    line[x] = lookup[row[x] & 0x3F];
+                }
+
+                write_row(line.data(), out, place, y);
+            }
+        });
+    }
+}
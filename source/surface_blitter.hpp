@@ -0,0 +1,98 @@
+#ifndef CYGNES_SURFACE_BLITTER_HPP
+#define CYGNES_SURFACE_BLITTER_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "frame_buffer.hpp"
+#include "thread_pool.hpp"
+
+/*
+ * Puts frames straight into a window surface, for hosts without a GPU, where
+ * SDL's "accelerated" renderer is really a software one that uploads every
+ * frame to a texture and then runs it through generic stretch and format
+ * blitters.
+ *
+ * Scaling is by whole numbers only: the largest that fits the NES picture in
+ * the surface, centered. Each source row is converted to the surface's format
+ * once (palette-index frames through the palette pre-converted to that
+ * format, ARGB frames with SSE2 channel shifts, or a plain copy when the
+ * surface is XRGB already), widened (with SSE2 for the common scales) and then
+ * copied down for the rest of its height. Rows are split into bands across a
+ * thread pool. 16- and 32-bit surfaces are supported.
+ */
+class surface_blitter
+{
+  public:
+    // Where and how to draw, as described by an SDL_Surface
+    struct target
+    {
+        void* pixels;
+        int pitch;
+        int width;
+        int height;
+        int bytes_per_pixel;
+        uint32_t red_mask;
+        uint32_t green_mask;
+        uint32_t blue_mask;
+    };
+
+    explicit surface_blitter(thread_pool& pool);
+
+    // An ARGB image of the whole NES picture, packed rows, at whatever size
+    // an upscaler or the NTSC filter made it
+    auto apply(const uint32_t* in, int width, int height, const target& out) -> void;
+
+    // A palette-index frame. Surfaces other than 16- or 32-bit are left as
+    // they are, as with the ARGB overload.
+    auto apply(const uint8_t* indices, const uint8_t* emphasis, const target& out) -> void;
+
+  private:
+    struct channel
+    {
+        int shift;
+        int bits;
+    };
+
+    // Whole-number scale in each direction, and which part of the surface
+    // the picture covers
+    struct placement
+    {
+        int scale_x;
+        int scale_y;
+        int columns;
+        int rows;
+        int left;
+        int top;
+
+        auto operator==(const placement& other) const -> bool;
+    };
+
+    thread_pool& m_pool;
+
+    // The surface format the tables were built for. m_xrgb is set when ARGB
+    // pixels can go in as they are, and m_simd_channels when no channel is
+    // wider than 8 bits, which is what the SSE2 conversion handles.
+    target m_format = {};
+    channel m_red = {};
+    channel m_green = {};
+    channel m_blue = {};
+    bool m_xrgb = false;
+    bool m_simd_channels = false;
+    std::vector<uint32_t> m_palette;
+
+    // Where the last picture went, so the borders are only cleared when the
+    // surface or the picture's place on it changes
+    target m_drawn_on = {};
+    placement m_drawn = {};
+
+    static auto supports(const target& out) -> bool;
+    static auto fit(const target& out, int width, int height) -> placement;
+
+    auto prepare(const target& out, const placement& place) -> void;
+    auto convert(uint32_t argb) const -> uint32_t;
+    auto convert_row(const uint32_t* in, uint32_t* out, int count) const -> void;
+    auto write_row(const uint32_t* line, const target& out, const placement& place, int row) const -> void;
+};
+
+#endif  // CYGNES_SURFACE_BLITTER_HPP
@@ -0,0 +1,104 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+thread_pool::thread_pool(int workers)
+{
+    for (int i = 0; i < workers; ++i)
+    {
+        m_workers.emplace_back(&thread_pool::worker_loop, this);
+    }
+}
+
+thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_start.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+auto thread_pool::size() const -> int
+{
+    return static_cast<int>(m_workers.size()) + 1;
+}
+
+auto thread_pool::parallel_for(int begin, int end, const std::function<void(int, int)>& body) -> void
+{
+    if (end <= begin)
+    {
+        return;
+    }
+
+    if (m_workers.empty())
+    {
+        body(begin, end);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_body = &body;
+        m_begin = begin;
+        m_end = end;
+        // A few more chunks than threads evens out uneven bands
+        m_chunks = std::min(end - begin, size() * 4);
+        m_next_chunk = 0;
+        m_busy_workers = static_cast<int>(m_workers.size());
+        m_generation++;
+    }
+    m_start.notify_all();
+
+    run_chunks();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]() { return m_busy_workers == 0; });
+    m_body = nullptr;
+}
+
+auto thread_pool::run_chunks() -> void
+{
+    int chunk;
+    int span = m_end - m_begin;
+
+    while ((chunk = m_next_chunk.fetch_add(1)) < m_chunks)
+    {
+        int chunk_begin = m_begin + static_cast<int>(static_cast<int64_t>(span) * chunk / m_chunks);
+        int chunk_end = m_begin + static_cast<int>(static_cast<int64_t>(span) * (chunk + 1) / m_chunks);
+        (*m_body)(chunk_begin, chunk_end);
+    }
+}
+
+auto thread_pool::worker_loop() -> void
+{
+    uint64_t seen_generation = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start.wait(lock, [&]() { return m_stopping or m_generation != seen_generation; });
+
+            if (m_stopping)
+            {
+                return;
+            }
+
+            seen_generation = m_generation;
+        }
+
+        run_chunks();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busy_workers--;
+        }
+        m_done.notify_one();
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef CYGNES_THREAD_POOL_HPP
+#define CYGNES_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * A handful of long-lived worker threads for splitting per-frame work (video
+ * filters and the like) into bands. parallel_for() hands out chunks of the
+ * range to the workers and the calling thread, and returns once every chunk
+ * is done, so callers never see a half-finished frame.
+ */
+class thread_pool
+{
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+
+    // The job currently being worked on
+    const std::function<void(int, int)>* m_body = nullptr;
+    int m_begin = 0;
+    int m_end = 0;
+    int m_chunks = 0;
+    std::atomic<int> m_next_chunk {0};
+
+    int m_busy_workers = 0;
+    uint64_t m_generation = 0;
+    bool m_stopping = false;
+
+    auto worker_loop() -> void;
+    auto run_chunks() -> void;
+
+  public:
+    explicit thread_pool(int workers);
+    ~thread_pool();
+
+    thread_pool(const thread_pool&) = delete;
+    auto operator=(const thread_pool&) -> thread_pool& = delete;
+
+    // Number of threads that take part in a parallel_for(), caller included
+    auto size() const -> int;
+
+    auto parallel_for(int begin, int end, const std::function<void(int, int)>& body) -> void;
+};
+
+#endif  // CYGNES_THREAD_POOL_HPP
@@ -0,0 +1,1007 @@
+#include "upscaler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define CYGNES_UPSCALER_SSE2 1
+#endif
+
+namespace
+{
+    const int src_width = frame_buffer::width;
+    const int src_height = frame_buffer::height;
+
+    auto row_at(uint32_t* out, int pitch, int row) -> uint32_t*
+    {
+        return reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(out) + static_cast<ptrdiff_t>(row) * pitch);
+    }
+
+#ifdef CYGNES_UPSCALER_SSE2
+    // Stores the 3x-wide run of output pixels for four source pixels: p0, q0,
+    // r0, p1, q1, r1, ... where p, q and r are the left, middle and right
+    // pixel each source pixel becomes
+    auto store_3x(uint32_t* dst, __m128i p, __m128i q, __m128i r) -> void
+    {
+        __m128 pq_lo = _mm_castsi128_ps(_mm_unpacklo_epi32(p, q));  // p0 q0 p1 q1
+        __m128 rp_lo = _mm_castsi128_ps(_mm_unpacklo_epi32(r, p));  // r0 p0 r1 p1
+        __m128 qr_lo = _mm_castsi128_ps(_mm_unpacklo_epi32(q, r));  // q0 r0 q1 r1
+        __m128 pq_hi = _mm_castsi128_ps(_mm_unpackhi_epi32(p, q));  // p2 q2 p3 q3
+        __m128 rp_hi = _mm_castsi128_ps(_mm_unpackhi_epi32(r, p));  // r2 p2 r3 p3
+        __m128 qr_hi = _mm_castsi128_ps(_mm_unpackhi_epi32(q, r));  // q2 r2 q3 r3
+
+        _mm_storeu_ps(reinterpret_cast<float*>(dst), _mm_shuffle_ps(pq_lo, rp_lo, _MM_SHUFFLE(3, 0, 1, 0)));
+        _mm_storeu_ps(reinterpret_cast<float*>(dst + 4), _mm_shuffle_ps(qr_lo, pq_hi, _MM_SHUFFLE(1, 0, 3, 2)));
+        _mm_storeu_ps(reinterpret_cast<float*>(dst + 8), _mm_shuffle_ps(rp_hi, qr_hi, _MM_SHUFFLE(3, 2, 3, 0)));
+    }
+
+    // Stores four source pixels doubled on both output rows, as nearest does
+    auto store_2x(uint32_t* top, uint32_t* bottom, __m128i pixels) -> void
+    {
+        __m128i lo = _mm_unpacklo_epi32(pixels, pixels);
+        __m128i hi = _mm_unpackhi_epi32(pixels, pixels);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(top), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(top + 4), hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(bottom), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(bottom + 4), hi);
+    }
+#endif
+
+    // Mixes three ARGB colors channel by channel; the weights add up to
+    // 1 << shift (16 at most, so two channels fit in each half of a word)
+    auto mix(uint32_t e, uint32_t we, uint32_t x, uint32_t wx, uint32_t y, uint32_t wy, int shift) -> uint32_t
+    {
+        const uint32_t mask = 0x00FF00FF;
+        uint32_t rb = ((e & mask) * we + (x & mask) * wx + (y & mask) * wy) >> shift;
+        uint32_t ag = (((e >> 8) & mask) * we + ((x >> 8) & mask) * wx + ((y >> 8) & mask) * wy) >> shift;
+
+        return (rb & mask) | ((ag & mask) << 8);
+    }
+
+    // hq2x -------------------------------------------------------------------
+
+    // hq2x compares colors by their Y, U and V, looked up by RGB565, and
+    // calls two colors different when any of those is further apart than
+    // this (both packed as 0x00YYUUVV)
+    const uint32_t hq_threshold = 0x00300706;
+
+    auto build_hq_yuv() -> std::array<uint32_t, 0x10000>
+    {
+        std::array<uint32_t, 0x10000> table{};
+
+        for (int color = 0; color < 0x10000; ++color)
+        {
+            int r = (color >> 11) << 3;
+            int g = ((color >> 5) & 0x3F) << 2;
+            int b = (color & 0x1F) << 3;
+
+            int y = (r + g + b) >> 2;
+            int u = 128 + ((r - b) >> 2);
+            int v = 128 + ((-r + 2 * g - b) >> 3);
+
+            table[color] = static_cast<uint32_t>((y << 16) | (u << 8) | v);
+        }
+
+        return table;
+    }
+
+    auto hq_yuv_table() -> const uint32_t*
+    {
+        static const std::array<uint32_t, 0x10000> table = build_hq_yuv();
+        return table.data();
+    }
+
+    auto hq_yuv(const uint32_t* table, uint32_t pixel) -> uint32_t
+    {
+        return table[((pixel >> 8) & 0xF800) | ((pixel >> 5) & 0x07E0) | ((pixel >> 3) & 0x001F)];
+    }
+
+    auto hq_differ(uint32_t a, uint32_t b) -> bool
+    {
+        bool differ = false;
+
+        for (int shift = 0; shift < 24; shift += 8)
+        {
+            uint32_t from = (a >> shift) & 0xFF;
+            uint32_t to = (b >> shift) & 0xFF;
+            differ = differ or (from > to ? from - to : to - from) > ((hq_threshold >> shift) & 0xFF);
+        }
+
+        return differ;
+    }
+
+    // How hq2x fills one output pixel: from the source pixel E alone or mixed
+    // with the pixel C diagonal to that corner and the pixels S and T beside
+    // it, S the one counterclockwise of C
+    enum hq_rule : uint8_t
+    {
+        hq_e,         // E
+        hq_e3_c,      // (3E + C) / 4
+        hq_e3_s,      // (3E + S) / 4
+        hq_e3_t,      // (3E + T) / 4
+        hq_e2_s_t,    // (2E + S + T) / 4
+        hq_e2_c_t,    // (2E + C + T) / 4
+        hq_e2_c_s,    // (2E + C + S) / 4
+        hq_e6_s_t,    // (6E + S + T) / 8
+        hq_e2_s3_t3,  // (2E + 3S + 3T) / 8
+        hq_e14_s_t    // (14E + S + T) / 16
+    };
+
+    // Where each output corner looks, as indices into E's 3x3 block
+    //   0 1 2
+    //   3 4 5
+    //   6 7 8
+    // C, S and T, the corners past S and T, and the pixels across from S and
+    // T. Each corner is the one before turned 90 degrees clockwise
+    struct hq_corner
+    {
+        int c, s, t, past_s, past_t, across_s, across_t;
+        int row, column;
+    };
+
+    const hq_corner hq_corners[4] = {
+        {0, 3, 1, 6, 2, 5, 7, 0, 0},
+        {2, 1, 5, 0, 8, 7, 3, 0, 1},
+        {8, 5, 7, 2, 6, 3, 1, 1, 1},
+        {6, 7, 3, 8, 0, 1, 5, 1, 0},
+    };
+
+    // Bit in the pattern that's set when neighbour n differs from E
+    auto hq_bit(int pattern, int n) -> bool
+    {
+        return (pattern >> (n < 4 ? n : n - 1)) & 1;
+    }
+
+    // The rule for a corner when S and T are like each other and when they
+    // aren't; the two only differ where S and T both differ from E
+    struct hq_choice
+    {
+        hq_rule similar;
+        hq_rule different;
+    };
+
+    auto build_hq_rules() -> std::array<hq_choice, 256 * 4>
+    {
+        std::array<hq_choice, 256 * 4> table{};
+
+        for (int pattern = 0; pattern < 256; ++pattern)
+        {
+            for (int q = 0; q < 4; ++q)
+            {
+                const hq_corner& at = hq_corners[q];
+                bool c = hq_bit(pattern, at.c);
+                bool s = hq_bit(pattern, at.s);
+                bool t = hq_bit(pattern, at.t);
+                hq_choice& choice = table[pattern * 4 + q];
+
+                if (!s and !t)
+                {
+                    choice = {hq_e2_s_t, hq_e2_s_t};
+                }
+                else if (!s)
+                {
+                    choice.similar = choice.different = c ? hq_e3_s : hq_e2_c_s;
+                }
+                else if (!t)
+                {
+                    choice.similar = choice.different = c ? hq_e3_t : hq_e2_c_t;
+                }
+                else if (!c)
+                {
+                    choice = {hq_e6_s_t, hq_e3_c};
+                }
+                else if (!hq_bit(pattern, at.past_s) and !hq_bit(pattern, at.past_t))
+                {
+                    // E is on a diagonal line, and S and T are the far side of it
+                    choice = {hq_e2_s3_t3, hq_e};
+                }
+                else if (hq_bit(pattern, at.across_s) and hq_bit(pattern, at.across_t))
+                {
+                    // E stands alone
+                    choice = {hq_e14_s_t, hq_e};
+                }
+                else
+                {
+                    choice = {hq_e2_s_t, hq_e};
+                }
+            }
+        }
+
+        return table;
+    }
+
+    auto hq_rule_table() -> const hq_choice*
+    {
+        static const std::array<hq_choice, 256 * 4> table = build_hq_rules();
+        return table.data();
+    }
+
+    auto hq_apply(hq_rule rule, uint32_t e, uint32_t c, uint32_t s, uint32_t t) -> uint32_t
+    {
+        uint32_t pixel = e;
+
+        switch (rule)
+        {
+            case hq_e:
+                break;
+            case hq_e3_c:
+                pixel = mix(e, 3, c, 1, 0, 0, 2);
+                break;
+            case hq_e3_s:
+                pixel = mix(e, 3, s, 1, 0, 0, 2);
+                break;
+            case hq_e3_t:
+                pixel = mix(e, 3, t, 1, 0, 0, 2);
+                break;
+            case hq_e2_s_t:
+                pixel = mix(e, 2, s, 1, t, 1, 2);
+                break;
+            case hq_e2_c_t:
+                pixel = mix(e, 2, c, 1, t, 1, 2);
+                break;
+            case hq_e2_c_s:
+                pixel = mix(e, 2, c, 1, s, 1, 2);
+                break;
+            case hq_e6_s_t:
+                pixel = mix(e, 6, s, 1, t, 1, 3);
+                break;
+            case hq_e2_s3_t3:
+                pixel = mix(e, 2, s, 3, t, 3, 3);
+                break;
+            case hq_e14_s_t:
+                pixel = mix(e, 14, s, 1, t, 1, 4);
+                break;
+        }
+
+        return pixel;
+    }
+
+    // xBRZ -------------------------------------------------------------------
+
+    const float xbrz_equal_color_tolerance = 30.0f;
+    const float xbrz_dominant_direction_threshold = 3.6f;
+    const float xbrz_steep_direction_threshold = 2.2f;
+
+    enum xbrz_blend : uint8_t
+    {
+        blend_none,
+        blend_normal,
+        blend_dominant
+    };
+
+    // How far apart two colors are in YCbCr (BT.2020 weights)
+    auto xbrz_distance(uint32_t a, uint32_t b) -> float
+    {
+        const float k_b = 0.0593f;
+        const float k_r = 0.2627f;
+        const float k_g = 1.0f - k_b - k_r;
+
+        float r = static_cast<float>(static_cast<int>((a >> 16) & 0xFF) - static_cast<int>((b >> 16) & 0xFF));
+        float g = static_cast<float>(static_cast<int>((a >> 8) & 0xFF) - static_cast<int>((b >> 8) & 0xFF));
+        float bl = static_cast<float>(static_cast<int>(a & 0xFF) - static_cast<int>(b & 0xFF));
+
+        float y = k_r * r + k_g * g + k_b * bl;
+        float c_b = 0.5f / (1.0f - k_b) * (bl - y);
+        float c_r = 0.5f / (1.0f - k_r) * (r - y);
+
+        return std::sqrt(y * y + c_b * c_b + c_r * c_r);
+    }
+
+    auto xbrz_equal(uint32_t a, uint32_t b) -> bool
+    {
+        return xbrz_distance(a, b) < xbrz_equal_color_tolerance;
+    }
+
+    // Moves back m/n of the way to front, channel by channel
+    auto xbrz_gradient(uint32_t front, uint32_t back, uint32_t m, uint32_t n) -> uint32_t
+    {
+        uint32_t pixel = 0;
+
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            uint32_t f = (front >> shift) & 0xFF;
+            uint32_t b = (back >> shift) & 0xFF;
+            pixel |= ((f * m + b * (n - m)) / n) << shift;
+        }
+
+        return pixel;
+    }
+
+    // Which of the four pixels meeting at the corner between F, G, J and K
+    // get that corner blended, from the 4x4 block around it
+    //   A B C D
+    //   E F G H
+    //   I J K L
+    //   M N O P
+    struct xbrz_corner
+    {
+        uint8_t f, g, j, k;
+    };
+
+    auto xbrz_preprocess(const uint32_t (&p)[16]) -> xbrz_corner
+    {
+        xbrz_corner result = {};
+
+        uint32_t b = p[1], c = p[2];
+        uint32_t e = p[4], f = p[5], g = p[6], h = p[7];
+        uint32_t i = p[8], j = p[9], k = p[10], l = p[11];
+        uint32_t n = p[13], o = p[14];
+
+        // Flat, or a straight edge between two colors
+        if (!((f == g and j == k) or (f == j and g == k)))
+        {
+            // Weighs an edge along J-G against one along F-K
+            float jg = xbrz_distance(i, f) + xbrz_distance(f, c) + xbrz_distance(n, k) + xbrz_distance(k, h)
+                + 4 * xbrz_distance(j, g);
+            float fk = xbrz_distance(e, j) + xbrz_distance(j, o) + xbrz_distance(b, g) + xbrz_distance(g, l)
+                + 4 * xbrz_distance(f, k);
+
+            if (jg < fk)
+            {
+                uint8_t blend = xbrz_dominant_direction_threshold * jg < fk ? blend_dominant : blend_normal;
+                if (f != g and f != j)
+                {
+                    result.f = blend;
+                }
+                if (k != j and k != g)
+                {
+                    result.k = blend;
+                }
+            }
+            else if (fk < jg)
+            {
+                uint8_t blend = xbrz_dominant_direction_threshold * fk < jg ? blend_dominant : blend_normal;
+                if (j != f and j != k)
+                {
+                    result.j = blend;
+                }
+                if (g != f and g != k)
+                {
+                    result.g = blend;
+                }
+            }
+        }
+
+        return result;
+    }
+
+    // A pixel's corner blends, two bits each: top left, top right, bottom
+    // right and bottom left from the low bits up
+    auto xbrz_top_right(uint8_t blends) -> int
+    {
+        return (blends >> 2) & 0x03;
+    }
+
+    auto xbrz_bottom_right(uint8_t blends) -> int
+    {
+        return (blends >> 4) & 0x03;
+    }
+
+    auto xbrz_bottom_left(uint8_t blends) -> int
+    {
+        return (blends >> 6) & 0x03;
+    }
+
+    // Blends the bottom right of E's 2x2 output, cells, given E's 3x3 block
+    //   A B C
+    //   D E F
+    //   G H I
+    // The other three corners are done by turning all three a quarter at a time
+    auto xbrz_blend_corner(const uint32_t (&p)[9], uint8_t blends, uint32_t* (&cells)[2][2]) -> void
+    {
+        if (xbrz_bottom_right(blends) != blend_none)
+        {
+            uint32_t b = p[1], c = p[2];
+            uint32_t d = p[3], e = p[4], f = p[5];
+            uint32_t g = p[6], h = p[7], i = p[8];
+
+            // A dominant blend is a line; otherwise not if the next corners
+            // blend too (a lone pixel, unless it's a right angle) or for an L
+            // shape, which only gets its corner rounded
+            bool line = xbrz_bottom_right(blends) == blend_dominant
+                or !((xbrz_top_right(blends) != blend_none and !xbrz_equal(e, g))
+                     or (xbrz_bottom_left(blends) != blend_none and !xbrz_equal(e, c))
+                     or (!xbrz_equal(e, i) and xbrz_equal(g, h) and xbrz_equal(h, i) and xbrz_equal(i, f)
+                         and xbrz_equal(f, c)));
+
+            uint32_t color = xbrz_distance(e, f) <= xbrz_distance(e, h) ? f : h;
+
+            if (line)
+            {
+                float fg = xbrz_distance(f, g);
+                float hc = xbrz_distance(h, c);
+                bool shallow = xbrz_steep_direction_threshold * fg <= hc and e != g and d != g;
+                bool steep = xbrz_steep_direction_threshold * hc <= fg and e != c and b != c;
+
+                if (shallow and steep)
+                {
+                    *cells[1][0] = xbrz_gradient(color, *cells[1][0], 1, 4);
+                    *cells[0][1] = xbrz_gradient(color, *cells[0][1], 1, 4);
+                    *cells[1][1] = xbrz_gradient(color, *cells[1][1], 5, 6);
+                }
+                else if (shallow)
+                {
+                    *cells[1][0] = xbrz_gradient(color, *cells[1][0], 1, 4);
+                    *cells[1][1] = xbrz_gradient(color, *cells[1][1], 3, 4);
+                }
+                else if (steep)
+                {
+                    *cells[0][1] = xbrz_gradient(color, *cells[0][1], 1, 4);
+                    *cells[1][1] = xbrz_gradient(color, *cells[1][1], 3, 4);
+                }
+                else
+                {
+                    *cells[1][1] = xbrz_gradient(color, *cells[1][1], 1, 2);
+                }
+            }
+            else
+            {
+                // A round corner: 1 - pi/4 of it
+                *cells[1][1] = xbrz_gradient(color, *cells[1][1], 21, 100);
+            }
+        }
+    }
+}
+
+upscaler::upscaler(kind type, thread_pool& pool)
+    : m_type(type)
+    , m_scale(type == nearest_3x or type == scale_3x ? 3 : 2)
+    , m_pool(pool)
+{
+}
+
+auto upscaler::from_name(const std::string& name, kind& type) -> bool
+{
+    bool success = true;
+
+    if (name == "nearest2x")
+    {
+        type = nearest_2x;
+    }
+    else if (name == "nearest3x")
+    {
+        type = nearest_3x;
+    }
+    else if (name == "scale2x")
+    {
+        type = scale_2x;
+    }
+    else if (name == "scale3x")
+    {
+        type = scale_3x;
+    }
+    else if (name == "hq2x")
+    {
+        type = hq_2x;
+    }
+    else if (name == "xbrz2x")
+    {
+        type = xbrz_2x;
+    }
+    else
+    {
+        success = false;
+    }
+
+    return success;
+}
+
+auto upscaler::scale() const -> int
+{
+    return m_scale;
+}
+
+auto upscaler::width() const -> int
+{
+    return src_width * m_scale;
+}
+
+auto upscaler::height() const -> int
+{
+    return src_height * m_scale;
+}
+
+auto upscaler::apply(const uint32_t* in, uint32_t* out, int pitch) -> void
+{
+    m_pool.parallel_for(0, src_height, [&](int first, int last) {
+        switch (m_type)
+        {
+            case nearest_2x:
+            case nearest_3x:
+                nearest_rows(in, out, pitch, first, last);
+                break;
+            case scale_2x:
+                scale2x_rows(in, out, pitch, first, last);
+                break;
+            case scale_3x:
+                scale3x_rows(in, out, pitch, first, last);
+                break;
+            case hq_2x:
+                hq2x_rows(in, out, pitch, first, last);
+                break;
+            case xbrz_2x:
+                xbrz_rows(in, out, pitch, first, last);
+                break;
+        }
+    });
+}
+
+auto upscaler::nearest_rows(const uint32_t* in, uint32_t* out, int pitch, int first, int last) const -> void
+{
+    for (int y = first; y < last; ++y)
+    {
+        const uint32_t* src = in + y * src_width;
+        uint32_t* dst = row_at(out, pitch, y * m_scale);
+        int x = 0;
+
+        if (m_scale == 2)
+        {
+#ifdef CYGNES_UPSCALER_SSE2
+            for (; x + 4 <= src_width; x += 4)
+            {
+                __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 2), _mm_unpacklo_epi32(pixels, pixels));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 2 + 4), _mm_unpackhi_epi32(pixels, pixels));
+            }
+#endif
+            for (; x < src_width; ++x)
+            {
+                dst[x * 2] = src[x];
+                dst[x * 2 + 1] = src[x];
+            }
+        }
+        else
+        {
+#ifdef CYGNES_UPSCALER_SSE2
+            for (; x + 4 <= src_width; x += 4)
+            {
+                __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 3), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(1, 0, 0, 0)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 3 + 4), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(2, 2, 1, 1)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 3 + 8), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(3, 3, 3, 2)));
+            }
+#endif
+            for (; x < src_width; ++x)
+            {
+                dst[x * 3] = src[x];
+                dst[x * 3 + 1] = src[x];
+                dst[x * 3 + 2] = src[x];
+            }
+        }
+
+        // The other output rows are straight copies of the first
+        for (int copy = 1; copy < m_scale; ++copy)
+        {
+            std::memcpy(row_at(out, pitch, y * m_scale + copy), dst, width() * sizeof(uint32_t));
+        }
+    }
+}
+
+auto upscaler::scale2x_rows(const uint32_t* in, uint32_t* out, int pitch, int first, int last) const -> void
+{
+    for (int y = first; y < last; ++y)
+    {
+        const uint32_t* above = in + std::max(y - 1, 0) * src_width;
+        const uint32_t* row = in + y * src_width;
+        const uint32_t* below = in + std::min(y + 1, src_height - 1) * src_width;
+        uint32_t* top = row_at(out, pitch, y * 2);
+        uint32_t* bottom = row_at(out, pitch, y * 2 + 1);
+
+        // B is above E, D left of it, F right of it and H below it
+        auto scalar = [&](int x) {
+            uint32_t b = above[x];
+            uint32_t d = row[std::max(x - 1, 0)];
+            uint32_t e = row[x];
+            uint32_t f = row[std::min(x + 1, src_width - 1)];
+            uint32_t h = below[x];
+
+            bool active = b != h and d != f;
+            top[x * 2] = active and d == b ? d : e;
+            top[x * 2 + 1] = active and b == f ? f : e;
+            bottom[x * 2] = active and d == h ? d : e;
+            bottom[x * 2 + 1] = active and h == f ? f : e;
+        };
+
+        int x = 0;
+        scalar(x++);
+
+#ifdef CYGNES_UPSCALER_SSE2
+        auto select = [](__m128i mask, __m128i yes, __m128i no) {
+            return _mm_or_si128(_mm_and_si128(mask, yes), _mm_andnot_si128(mask, no));
+        };
+        const __m128i ones = _mm_set1_epi32(-1);
+
+        for (; x + 4 < src_width; x += 4)
+        {
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(above + x));
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x - 1));
+            __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+            __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + 1));
+            __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + x));
+
+            __m128i active = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi32(b, h), _mm_cmpeq_epi32(d, f)), ones);
+
+            __m128i e0 = select(_mm_and_si128(active, _mm_cmpeq_epi32(d, b)), d, e);
+            __m128i e1 = select(_mm_and_si128(active, _mm_cmpeq_epi32(b, f)), f, e);
+            __m128i e2 = select(_mm_and_si128(active, _mm_cmpeq_epi32(d, h)), d, e);
+            __m128i e3 = select(_mm_and_si128(active, _mm_cmpeq_epi32(h, f)), f, e);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(top + x * 2), _mm_unpacklo_epi32(e0, e1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(top + x * 2 + 4), _mm_unpackhi_epi32(e0, e1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(bottom + x * 2), _mm_unpacklo_epi32(e2, e3));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(bottom + x * 2 + 4), _mm_unpackhi_epi32(e2, e3));
+        }
+#endif
+
+        for (; x < src_width; ++x)
+        {
+            scalar(x);
+        }
+    }
+}
+
+auto upscaler::scale3x_rows(const uint32_t* in, uint32_t* out, int pitch, int first, int last) const -> void
+{
+    for (int y = first; y < last; ++y)
+    {
+        const uint32_t* above = in + std::max(y - 1, 0) * src_width;
+        const uint32_t* row = in + y * src_width;
+        const uint32_t* below = in + std::min(y + 1, src_height - 1) * src_width;
+        uint32_t* out0 = row_at(out, pitch, y * 3);
+        uint32_t* out1 = row_at(out, pitch, y * 3 + 1);
+        uint32_t* out2 = row_at(out, pitch, y * 3 + 2);
+
+        auto scalar = [&](int x) {
+            int left = std::max(x - 1, 0);
+            int right = std::min(x + 1, src_width - 1);
+
+            // A B C
+            // D E F
+            // G H I
+            uint32_t a = above[left], b = above[x], c = above[right];
+            uint32_t d = row[left], e = row[x], f = row[right];
+            uint32_t g = below[left], h = below[x], i = below[right];
+
+            uint32_t* o0 = out0 + x * 3;
+            uint32_t* o1 = out1 + x * 3;
+            uint32_t* o2 = out2 + x * 3;
+
+            if (b != h and d != f)
+            {
+                bool db = d == b, bf = b == f, dh = d == h, hf = h == f;
+
+                o0[0] = db ? d : e;
+                o0[1] = (db and e != c) or (bf and e != a) ? b : e;
+                o0[2] = bf ? f : e;
+                o1[0] = (db and e != g) or (dh and e != a) ? d : e;
+                o1[1] = e;
+                o1[2] = (bf and e != i) or (hf and e != c) ? f : e;
+                o2[0] = dh ? d : e;
+                o2[1] = (dh and e != i) or (hf and e != g) ? h : e;
+                o2[2] = hf ? f : e;
+            }
+            else
+            {
+                o0[0] = o0[1] = o0[2] = e;
+                o1[0] = o1[1] = o1[2] = e;
+                o2[0] = o2[1] = o2[2] = e;
+            }
+        };
+
+        int x = 0;
+        scalar(x++);
+
+#ifdef CYGNES_UPSCALER_SSE2
+        auto select = [](__m128i mask, __m128i yes, __m128i no) {
+            return _mm_or_si128(_mm_and_si128(mask, yes), _mm_andnot_si128(mask, no));
+        };
+        auto load = [](const uint32_t* pixels) {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels));
+        };
+        const __m128i ones = _mm_set1_epi32(-1);
+
+        for (; x + 4 < src_width; x += 4)
+        {
+            __m128i a = load(above + x - 1), b = load(above + x), c = load(above + x + 1);
+            __m128i d = load(row + x - 1), e = load(row + x), f = load(row + x + 1);
+            __m128i g = load(below + x - 1), h = load(below + x), i = load(below + x + 1);
+
+            __m128i active = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi32(b, h), _mm_cmpeq_epi32(d, f)), ones);
+            __m128i db = _mm_and_si128(active, _mm_cmpeq_epi32(d, b));
+            __m128i bf = _mm_and_si128(active, _mm_cmpeq_epi32(b, f));
+            __m128i dh = _mm_and_si128(active, _mm_cmpeq_epi32(d, h));
+            __m128i hf = _mm_and_si128(active, _mm_cmpeq_epi32(h, f));
+            __m128i ea = _mm_cmpeq_epi32(e, a), ec = _mm_cmpeq_epi32(e, c);
+            __m128i eg = _mm_cmpeq_epi32(e, g), ei = _mm_cmpeq_epi32(e, i);
+
+            store_3x(out0 + x * 3,
+                     select(db, d, e),
+                     select(_mm_or_si128(_mm_andnot_si128(ec, db), _mm_andnot_si128(ea, bf)), b, e),
+                     select(bf, f, e));
+            store_3x(out1 + x * 3,
+                     select(_mm_or_si128(_mm_andnot_si128(eg, db), _mm_andnot_si128(ea, dh)), d, e),
+                     e,
+                     select(_mm_or_si128(_mm_andnot_si128(ei, bf), _mm_andnot_si128(ec, hf)), f, e));
+            store_3x(out2 + x * 3,
+                     select(dh, d, e),
+                     select(_mm_or_si128(_mm_andnot_si128(ei, dh), _mm_andnot_si128(eg, hf)), h, e),
+                     select(hf, f, e));
+        }
+#endif
+
+        for (; x < src_width; ++x)
+        {
+            scalar(x);
+        }
+    }
+}
+
+auto upscaler::hq2x_rows(const uint32_t* in, uint32_t* out, int pitch, int first, int last) const -> void
+{
+    const uint32_t* yuv_table = hq_yuv_table();
+    const hq_choice* rules = hq_rule_table();
+
+    // The band's rows and one either side, as pixels and as YUV, with the
+    // edge columns repeated so every neighbour can be read straight
+    const int stride = src_width + 2;
+    std::vector<uint32_t> pixels((last - first + 2) * stride);
+    std::vector<uint32_t> yuv(pixels.size());
+
+    for (int y = first - 1; y <= last; ++y)
+    {
+        const uint32_t* src = in + std::min(std::max(y, 0), src_height - 1) * src_width;
+        int at = (y - first + 1) * stride + 1;
+
+        for (int x = -1; x <= src_width; ++x)
+        {
+            pixels[at + x] = src[std::min(std::max(x, 0), src_width - 1)];
+            yuv[at + x] = hq_yuv(yuv_table, pixels[at + x]);
+        }
+    }
+
+    for (int y = first; y < last; ++y)
+    {
+        // Neighbour n of the pixel at x is at rows[n / 3][x + n % 3 - 1]
+        int at = (y - first + 1) * stride + 1;
+        const uint32_t* rows[3] = {&pixels[at - stride], &pixels[at], &pixels[at + stride]};
+        const uint32_t* yuv_rows[3] = {&yuv[at - stride], &yuv[at], &yuv[at + stride]};
+        uint32_t* top = row_at(out, pitch, y * 2);
+        uint32_t* bottom = row_at(out, pitch, y * 2 + 1);
+
+        auto scalar = [&](int x, int pattern) {
+            uint32_t w[9];
+            for (int n = 0; n < 9; ++n)
+            {
+                w[n] = rows[n / 3][x + n % 3 - 1];
+            }
+
+            uint32_t* cells[2] = {top + x * 2, bottom + x * 2};
+
+            for (int q = 0; q < 4; ++q)
+            {
+                const hq_corner& corner = hq_corners[q];
+                hq_choice choice = rules[pattern * 4 + q];
+                hq_rule rule = choice.similar;
+
+                if (choice.different != choice.similar
+                    and hq_differ(yuv_rows[corner.s / 3][x + corner.s % 3 - 1],
+                                  yuv_rows[corner.t / 3][x + corner.t % 3 - 1]))
+                {
+                    rule = choice.different;
+                }
+
+                cells[corner.row][corner.column] = hq_apply(rule, w[4], w[corner.c], w[corner.s], w[corner.t]);
+            }
+        };
+
+        int x = 0;
+
+#ifdef CYGNES_UPSCALER_SSE2
+        const __m128i threshold = _mm_set1_epi32(static_cast<int>(hq_threshold));
+        const __m128i zero = _mm_setzero_si128();
+
+        for (; x + 4 <= src_width; x += 4)
+        {
+            __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[1] + x));
+            __m128i e_yuv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(yuv_rows[1] + x));
+            __m128i pattern = zero;
+            __m128i flat = _mm_set1_epi32(-1);
+
+            for (int n = 0, bit = 1; n < 9; ++n)
+            {
+                if (n != 4)
+                {
+                    const uint32_t* neighbour = rows[n / 3] + x + n % 3 - 1;
+                    const uint32_t* neighbour_yuv = yuv_rows[n / 3] + x + n % 3 - 1;
+                    __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(neighbour));
+                    __m128i w_yuv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(neighbour_yuv));
+
+                    // Any of Y, U and V further apart than its threshold
+                    __m128i distance = _mm_or_si128(_mm_subs_epu8(w_yuv, e_yuv), _mm_subs_epu8(e_yuv, w_yuv));
+                    __m128i within = _mm_cmpeq_epi32(_mm_subs_epu8(distance, threshold), zero);
+
+                    pattern = _mm_or_si128(pattern, _mm_andnot_si128(within, _mm_set1_epi32(bit)));
+                    flat = _mm_and_si128(flat, _mm_cmpeq_epi32(w, e));
+                    bit <<= 1;
+                }
+            }
+
+            // Every rule mixes E with pixels equal to it
+            if (_mm_movemask_ps(_mm_castsi128_ps(flat)) == 0x0F)
+            {
+                store_2x(top + x * 2, bottom + x * 2, e);
+            }
+            else
+            {
+                alignas(16) int patterns[4];
+                _mm_store_si128(reinterpret_cast<__m128i*>(patterns), pattern);
+
+                for (int lane = 0; lane < 4; ++lane)
+                {
+                    scalar(x + lane, patterns[lane]);
+                }
+            }
+        }
+#endif
+
+        for (; x < src_width; ++x)
+        {
+            int pattern = 0;
+            for (int n = 0, bit = 1; n < 9; ++n)
+            {
+                if (n != 4)
+                {
+                    if (hq_differ(yuv_rows[n / 3][x + n % 3 - 1], yuv_rows[1][x]))
+                    {
+                        pattern |= bit;
+                    }
+                    bit <<= 1;
+                }
+            }
+
+            scalar(x, pattern);
+        }
+    }
+}
+
+auto upscaler::xbrz_rows(const uint32_t* in, uint32_t* out, int pitch, int first, int last) const -> void
+{
+    auto pixel = [&](int x, int y) {
+        return in[std::min(std::max(y, 0), src_height - 1) * src_width + std::min(std::max(x, 0), src_width - 1)];
+    };
+
+    // The corners below and right of each pixel in the row above the band
+    // down to its last row; corners off the top or left of the picture
+    // aren't blended. The row above is worked out again by the band that
+    // owns it, so bands never wait on each other
+    const int stride = src_width + 1;
+    std::vector<xbrz_corner> corners((last - first + 1) * stride);
+
+    auto corner_at = [&](int x, int y) -> xbrz_corner& {
+        return corners[(y - first + 1) * stride + x + 1];
+    };
+
+    auto preprocess = [&](int x, int y) {
+        uint32_t p[16];
+        for (int n = 0; n < 16; ++n)
+        {
+            p[n] = pixel(x + n % 4 - 1, y + n / 4 - 1);
+        }
+
+        corner_at(x, y) = xbrz_preprocess(p);
+    };
+
+    for (int y = std::max(first - 1, 0); y < last; ++y)
+    {
+        int x = 0;
+
+#ifdef CYGNES_UPSCALER_SSE2
+        const uint32_t* row = in + y * src_width;
+        const uint32_t* next = in + std::min(y + 1, src_height - 1) * src_width;
+
+        for (; x + 4 < src_width; x += 4)
+        {
+            __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+            __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + 1));
+            __m128i j = _mm_loadu_si128(reinterpret_cast<const __m128i*>(next + x));
+            __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(next + x + 1));
+
+            // The corners xbrz_preprocess() would pass over
+            __m128i plain = _mm_or_si128(_mm_and_si128(_mm_cmpeq_epi32(f, g), _mm_cmpeq_epi32(j, k)),
+                                         _mm_and_si128(_mm_cmpeq_epi32(f, j), _mm_cmpeq_epi32(g, k)));
+            int skip = _mm_movemask_ps(_mm_castsi128_ps(plain));
+
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                if (!((skip >> lane) & 1))
+                {
+                    preprocess(x + lane, y);
+                }
+            }
+        }
+#endif
+
+        for (; x < src_width; ++x)
+        {
+            preprocess(x, y);
+        }
+    }
+
+    for (int y = first; y < last; ++y)
+    {
+        const uint32_t* row = in + y * src_width;
+        uint32_t* top = row_at(out, pitch, y * 2);
+        uint32_t* bottom = row_at(out, pitch, y * 2 + 1);
+
+        auto blends_at = [&](int x) {
+            return static_cast<uint8_t>(corner_at(x - 1, y - 1).k
+                                        | corner_at(x, y - 1).j << 2
+                                        | corner_at(x, y).f << 4
+                                        | corner_at(x - 1, y).g << 6);
+        };
+
+        auto scalar = [&](int x, uint8_t blends) {
+            uint32_t e = row[x];
+            top[x * 2] = top[x * 2 + 1] = bottom[x * 2] = bottom[x * 2 + 1] = e;
+
+            if (blends != 0)
+            {
+                uint32_t p[9];
+                for (int n = 0; n < 9; ++n)
+                {
+                    p[n] = pixel(x + n % 3 - 1, y + n / 3 - 1);
+                }
+
+                uint32_t* cells[2][2] = {{top + x * 2, top + x * 2 + 1}, {bottom + x * 2, bottom + x * 2 + 1}};
+
+                for (int turn = 0; turn < 4; ++turn)
+                {
+                    xbrz_blend_corner(p, blends, cells);
+
+                    // A quarter turn clockwise brings the next corner
+                    // counterclockwise round to the bottom right
+                    const uint32_t turned[9] = {p[6], p[3], p[0], p[7], p[4], p[1], p[8], p[5], p[2]};
+                    std::copy(turned, turned + 9, p);
+                    blends = static_cast<uint8_t>((blends << 2) | (blends >> 6));
+                    uint32_t* corner = cells[0][0];
+                    cells[0][0] = cells[1][0];
+                    cells[1][0] = cells[1][1];
+                    cells[1][1] = cells[0][1];
+                    cells[0][1] = corner;
+                }
+            }
+        };
+
+        int x = 0;
+
+#ifdef CYGNES_UPSCALER_SSE2
+        for (; x + 4 <= src_width; x += 4)
+        {
+            uint8_t blends[4] = {blends_at(x), blends_at(x + 1), blends_at(x + 2), blends_at(x + 3)};
+
+            if ((blends[0] | blends[1] | blends[2] | blends[3]) == 0)
+            {
+                store_2x(top + x * 2, bottom + x * 2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x)));
+            }
+            else
+            {
+                for (int lane = 0; lane < 4; ++lane)
+                {
+                    scalar(x + lane, blends[lane]);
+                }
+            }
+        }
+#endif
+
+        for (; x < src_width; ++x)
+        {
+            scalar(x, blends_at(x));
+        }
+    }
+}
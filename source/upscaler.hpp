@@ -0,0 +1,59 @@
+#ifndef CYGNES_UPSCALER_HPP
+#define CYGNES_UPSCALER_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "frame_buffer.hpp"
+#include "thread_pool.hpp"
+
+/*
+ * Software pixel-art upscalers that run on the ARGB frame before it goes to
+ * the texture, for hosts where the renderer's own scaling is a slow software
+ * blit anyway. Every filter works on bands of source rows across a thread
+ * pool and writes its output straight to wherever it's pointed (usually the
+ * locked texture).
+ *
+ * nearest and scale2x/3x have SSE2 paths on x86 (which every x86-64 CPU has),
+ * with a scalar loop for the edge columns and for other targets. hq2x and
+ * xbrz2x mix colors pixel by pixel, which stays scalar; SSE2 does hq2x's YUV
+ * threshold compares and finds the runs of pixels neither filter has
+ * anything to mix into, which go out the way nearest2x writes them.
+ */
+class upscaler
+{
+  public:
+    enum kind
+    {
+        nearest_2x,
+        nearest_3x,
+        scale_2x,
+        scale_3x,
+        hq_2x,
+        xbrz_2x
+    };
+
+    upscaler(kind type, thread_pool& pool);
+
+    static auto from_name(const std::string& name, kind& type) -> bool;
+
+    auto scale() const -> int;
+    auto width() const -> int;
+    auto height() const -> int;
+
+    // Writes a width() x height() ARGB image; pitch is in bytes
+    auto apply(const uint32_t* in, uint32_t* out, int pitch) -> void;
+
+  private:
+    kind m_type;
+    int m_scale;
+    thread_pool& m_pool;
+
+    auto nearest_rows(const uint32_t* in, uint32_t* out, int pitch, int first, int last) const -> void;
+    auto scale2x_rows(const uint32_t* in, uint32_t* out, int pitch, int first, int last) const -> void;
+    auto scale3x_rows(const uint32_t* in, uint32_t* out, int pitch, int first, int last) const -> void;
+    auto hq2x_rows(const uint32_t* in, uint32_t* out, int pitch, int first, int last) const -> void;
+    auto xbrz_rows(const uint32_t* in, uint32_t* out, int pitch, int first, int last) const -> void;
+};
+
+#endif  // CYGNES_UPSCALER_HPP
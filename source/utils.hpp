@@ -8,6 +8,9 @@
 #include "SDL.h"
 #include <memory>
 
+// Just SDL and the window, for drawing to the window surface without a renderer
+bool init_window(std::shared_ptr<SDL_Window>& window, int screen_width, int screen_height);
+
 bool init(std::shared_ptr<SDL_Window>& window, std::shared_ptr<SDL_Renderer>& renderer, int screen_width, int screen_height);
 
 #endif //CYGNES_UTILS_H
@@ -0,0 +1,681 @@
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "ntsc_filter.hpp"
+#include "ppu.hpp"
+#include "scanline_renderer.hpp"
+#include "surface_blitter.hpp"
+#include "test_fixtures.hpp"
+#include "thread_pool.hpp"
+#include "upscaler.hpp"
+
+// Fills a throwaway image so the benchmarks don't depend on a game: every
+// byte is a function of its offset in the file
+static auto fill_test_rom(test_rom& rom) -> void
+{
+    for (int i = 0; i < rom.prg_size(); ++i)
+    {
+        rom.prg()[i] = static_cast<char>((test_rom::header_size + i) * 37);
+    }
+    for (int i = 0; i < rom.chr_size(); ++i)
+    {
+        rom.chr()[i] = static_cast<char>((test_rom::header_size + rom.prg_size() + i) * 37);
+    }
+}
+
+// Fills the nametables and palette with something non-trivial and turns on
+// background rendering
+static auto setup_ppu(ppu& PPU) -> void
+{
+    PPU.reg_write(0x06, 0x20);
+    PPU.reg_write(0x06, 0x00);
+    for (int i = 0; i < 0x800; ++i)
+    {
+        PPU.reg_write(0x07, static_cast<uint8_t>(i * 7));
+    }
+
+    PPU.reg_write(0x06, 0x3F);
+    PPU.reg_write(0x06, 0x00);
+    for (int i = 0; i < 0x20; ++i)
+    {
+        PPU.reg_write(0x07, static_cast<uint8_t>(i * 5));
+    }
+
+    PPU.reg_write(0x01, 0x0A);
+}
+
+static auto run_frames(ppu& PPU, int frames) -> double
+{
+    const int dots_per_frame = 341 * 262;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int dot = 0; dot < frames * dots_per_frame; ++dot)
+    {
+        PPU.step();
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count() / frames;
+}
+
+static auto bench_frame_skip(std::shared_ptr<cartridge>& cart) -> void
+{
+    const int frames = 240;
+    double baseline = 0.0;
+
+    for (int skip : {0, 1, 3, 7})
+    {
+        ppu PPU;
+        PPU.connect_cartridge(cart);
+        PPU.reset();
+        setup_ppu(PPU);
+        PPU.set_frame_skip(skip);
+
+        double per_frame = run_frames(PPU, frames);
+        if (skip == 0)
+        {
+            baseline = per_frame;
+        }
+
+        printf("frame skip %d: %10.1f us/frame (%.2fx)\n", skip, per_frame, baseline / per_frame);
+    }
+}
+
+// FNV-1a, standing in for a headless consumer (e.g. a test comparing frame
+// hashes) that never needs to see real colors
+static auto hash_bytes(const void* data, size_t size) -> uint64_t
+{
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = 0xCBF29CE484222325;
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ bytes[i]) * 0x100000001B3;
+    }
+
+    return hash;
+}
+
+static auto bench_frame_formats(std::shared_ptr<cartridge>& cart) -> void
+{
+    const int frames = 240;
+    const int dots_per_frame = 341 * 262;
+
+    for (auto format : {frame_buffer::argb, frame_buffer::palette_index})
+    {
+        bool indexed = format == frame_buffer::palette_index;
+        std::shared_ptr<frame_buffer> buffer = std::make_shared<frame_buffer>(format);
+
+        ppu PPU;
+        PPU.connect_cartridge(cart);
+        PPU.connect_frame_buffer(buffer);
+        PPU.reset();
+        setup_ppu(PPU);
+
+        size_t frame_bytes = indexed
+            ? frame_buffer::pixel_count + frame_buffer::height
+            : frame_buffer::pixel_count * sizeof(uint32_t);
+        uint64_t hash = 0;
+        std::chrono::duration<double, std::micro> emulating {0};
+        std::chrono::duration<double, std::micro> hashing {0};
+
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            // The test screen never changes; make every frame a new one so
+            // each gets published and hashed
+            PPU.invalidate_frame();
+
+            auto start = std::chrono::steady_clock::now();
+            for (int dot = 0; dot < dots_per_frame; ++dot)
+            {
+                PPU.step();
+            }
+            auto emulated = std::chrono::steady_clock::now();
+
+            if (buffer->acquire())
+            {
+                if (indexed)
+                {
+                    hash ^= hash_bytes(buffer->front_indices(), frame_buffer::pixel_count);
+                    hash ^= hash_bytes(buffer->front_emphasis(), frame_buffer::height);
+                }
+                else
+                {
+                    hash ^= hash_bytes(buffer->front(), frame_bytes);
+                }
+            }
+
+            emulating += emulated - start;
+            hashing += std::chrono::steady_clock::now() - emulated;
+        }
+
+        printf("%-6s frames (%6zu bytes): %10.1f us/frame emulating, %8.1f us/frame hashing (%016llx)\n",
+               indexed ? "index" : "argb",
+               frame_bytes,
+               emulating.count() / frames,
+               hashing.count() / frames,
+               static_cast<unsigned long long>(hash));
+    }
+}
+
+static auto bench_static_frames(std::shared_ptr<cartridge>& cart) -> void
+{
+    const int frames = 240;
+    const int dots_per_frame = 341 * 262;
+
+    for (bool animate : {false, true})
+    {
+        ppu PPU;
+        PPU.connect_cartridge(cart);
+        PPU.reset();
+        setup_ppu(PPU);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            for (int dot = 0; dot < dots_per_frame; ++dot)
+            {
+                PPU.step();
+            }
+
+            // Cycle one palette entry during vblank, like a blinking cursor
+            if (animate)
+            {
+                PPU.reg_write(0x06, 0x3F);
+                PPU.reg_write(0x06, 0x01);
+                PPU.reg_write(0x07, static_cast<uint8_t>(frame));
+                PPU.reg_write(0x06, 0x00);
+                PPU.reg_write(0x06, 0x00);
+            }
+        }
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+        printf("%-8s screen: %10.1f us/frame, %3llu of %d frames reused\n",
+               animate ? "animated" : "static",
+               elapsed.count() / frames,
+               static_cast<unsigned long long>(PPU.static_frames()),
+               frames);
+    }
+}
+
+static auto bench_pipeline(std::shared_ptr<cartridge>& cart) -> void
+{
+    const int frames = 240;
+    const int dots_per_frame = ppu::dots_per_line * ppu::lines_per_frame;
+
+    for (bool pipelined : {false, true})
+    {
+        ppu PPU;
+        PPU.connect_cartridge(cart);
+        PPU.reset();
+        setup_ppu(PPU);
+        PPU.set_pipelined(pipelined);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            // Keep every frame a new one, so none is skipped as static
+            PPU.invalidate_frame();
+
+            for (int dot = 0; dot < dots_per_frame; ++dot)
+            {
+                PPU.step();
+            }
+        }
+        auto emulated = std::chrono::steady_clock::now();
+
+        // Waits for the worker to draw the last frame
+        PPU.set_pipelined(false);
+        auto drawn = std::chrono::steady_clock::now();
+
+        std::chrono::duration<double, std::micro> emulating = emulated - start;
+        std::chrono::duration<double, std::micro> total = drawn - start;
+
+        printf("%-9s %10.1f us/frame on the emulation thread, %10.1f us/frame overall\n",
+               pipelined ? "pipelined" : "in place",
+               emulating.count() / frames,
+               total.count() / frames);
+    }
+}
+
+static auto bench_scanline_renderer(std::shared_ptr<cartridge>& cart) -> void
+{
+    const int frames = 120;
+
+    // A recorded frame: the state at the top of a frame, plus a scroll split
+    // halfway down like a status bar would have
+    ppu::frame_log log;
+    {
+        ppu PPU;
+        PPU.connect_cartridge(cart);
+        PPU.reset();
+        setup_ppu(PPU);
+        run_frames(PPU, 1);
+        PPU.save_state(log.start);
+    }
+    uint32_t split = 120 * ppu::dots_per_line + 260;
+    log.accesses.push_back({split, ppu::logged_access::reg_write, 0x05, 0x40});
+    log.accesses.push_back({split, ppu::logged_access::reg_write, 0x05, 0x00});
+
+    {
+        std::shared_ptr<frame_buffer> buffer = std::make_shared<frame_buffer>();
+        ppu replica;
+        replica.connect_frame_buffer(buffer);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            replica.invalidate_frame();
+            replica.replay(log);
+        }
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+        printf("replay in order:        %10.1f us/frame\n", elapsed.count() / frames);
+    }
+
+    for (int workers : {0, 1, 3})
+    {
+        frame_buffer buffer;
+        thread_pool pool(workers);
+        scanline_renderer renderer(pool);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            renderer.render(log, buffer);
+        }
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+        printf("scanline bands, %d workers: %10.1f us/frame\n", workers, elapsed.count() / frames);
+    }
+}
+
+static auto bench_ntsc_filter() -> void
+{
+    const int frames = 120;
+
+    std::vector<uint8_t> indices(frame_buffer::pixel_count);
+    std::vector<uint8_t> emphasis(frame_buffer::height);
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        indices[i] = static_cast<uint8_t>((i * 13 + i / 256) & 0x3F);
+    }
+    for (size_t line = 0; line < emphasis.size(); ++line)
+    {
+        emphasis[line] = static_cast<uint8_t>(line / 30);
+    }
+
+    for (int scale : {2, 3})
+    {
+        for (int workers : {0, 1, 2})
+        {
+            thread_pool pool(workers);
+            ntsc_filter filter(scale, pool);
+            std::vector<uint32_t> out(filter.width() * filter.height());
+
+            auto start = std::chrono::steady_clock::now();
+            for (int frame = 0; frame < frames; ++frame)
+            {
+                filter.apply(indices.data(), emphasis.data(), out.data(), filter.width() * sizeof(uint32_t));
+            }
+            std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+            printf("ntsc %dx, %d workers: %10.1f us/frame\n", scale, workers, elapsed.count() / frames);
+        }
+    }
+}
+
+static auto bench_upscalers() -> void
+{
+    const int frames = 60;
+
+    // Big flat areas with hard edges, roughly what NES frames look like
+    std::vector<uint32_t> frame(frame_buffer::pixel_count);
+    for (int y = 0; y < frame_buffer::height; ++y)
+    {
+        for (int x = 0; x < frame_buffer::width; ++x)
+        {
+            frame[y * frame_buffer::width + x] = ((x / 8 + y / 8) % 3 == 0 or (x + y) % 11 == 0) ? 0xFF2038EC : 0xFF000000 | (y << 8);
+        }
+    }
+
+    for (const char* name : {"nearest2x", "nearest3x", "scale2x", "scale3x", "hq2x", "xbrz2x"})
+    {
+        upscaler::kind type;
+        upscaler::from_name(name, type);
+
+        for (int workers : {0, 2})
+        {
+            thread_pool pool(workers);
+            upscaler scaler(type, pool);
+            std::vector<uint32_t> out(scaler.width() * scaler.height());
+
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < frames; ++i)
+            {
+                scaler.apply(frame.data(), out.data(), scaler.width() * sizeof(uint32_t));
+            }
+            std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+            printf("%-9s %d workers: %10.1f us/frame\n", name, workers, elapsed.count() / frames);
+        }
+    }
+}
+
+static auto bench_surface_blitter() -> void
+{
+    const int frames = 120;
+
+    std::vector<uint8_t> indices(frame_buffer::pixel_count);
+    std::vector<uint8_t> emphasis(frame_buffer::height, 0);
+    std::vector<uint32_t> colors(frame_buffer::pixel_count);
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        indices[i] = static_cast<uint8_t>((i * 13 + i / 256) & 0x3F);
+        colors[i] = palette::argb()[indices[i]];
+    }
+
+    struct surface_kind
+    {
+        const char* name;
+        int scale;
+        int bytes_per_pixel;
+        uint32_t red_mask;
+        uint32_t green_mask;
+        uint32_t blue_mask;
+    };
+
+    // What X11 and the like usually hand out, a byte-swapped one and a
+    // 16-bit one
+    const surface_kind kinds[] = {
+        {"xrgb8888", 2, 4, 0xFF0000, 0x00FF00, 0x0000FF},
+        {"xrgb8888", 3, 4, 0xFF0000, 0x00FF00, 0x0000FF},
+        {"xbgr8888", 3, 4, 0x0000FF, 0x00FF00, 0xFF0000},
+        {"rgb565", 3, 2, 0xF800, 0x07E0, 0x001F},
+    };
+
+    for (const surface_kind& kind : kinds)
+    {
+        int width = frame_buffer::width * kind.scale;
+        int height = frame_buffer::height * kind.scale;
+        std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * kind.bytes_per_pixel);
+        surface_blitter::target out = {pixels.data(), width * kind.bytes_per_pixel, width, height, kind.bytes_per_pixel, kind.red_mask, kind.green_mask, kind.blue_mask};
+
+        for (int workers : {0, 2})
+        {
+            thread_pool pool(workers);
+            surface_blitter blitter(pool);
+
+            auto start = std::chrono::steady_clock::now();
+            for (int frame = 0; frame < frames; ++frame)
+            {
+                blitter.apply(indices.data(), emphasis.data(), out);
+            }
+            std::chrono::duration<double, std::micro> index_time = std::chrono::steady_clock::now() - start;
+
+            start = std::chrono::steady_clock::now();
+            for (int frame = 0; frame < frames; ++frame)
+            {
+                blitter.apply(colors.data(), frame_buffer::width, frame_buffer::height, out);
+            }
+            std::chrono::duration<double, std::micro> argb_time = std::chrono::steady_clock::now() - start;
+
+            printf("surface %s %dx, %d workers: %8.1f us/frame from indices, %8.1f us/frame from ARGB\n",
+                   kind.name,
+                   kind.scale,
+                   workers,
+                   index_time.count() / frames,
+                   argb_time.count() / frames);
+        }
+    }
+}
+
+// Bank register writes behind the virtual interface mappers used to have, as
+// the baseline for std::visit
+struct virtual_mapper
+{
+    virtual ~virtual_mapper() = default;
+    virtual auto cpu_write(uint16_t addr, uint8_t byte) -> void = 0;
+};
+
+template <typename T>
+struct virtual_wrapper : virtual_mapper
+{
+    T m_mapper;
+
+    explicit virtual_wrapper(T inner) : m_mapper(inner) {}
+
+    auto cpu_write(uint16_t addr, uint8_t byte) -> void override
+    {
+        m_mapper.cpu_write(addr, byte);
+    }
+};
+
+static auto bench_mapper_dispatch(std::shared_ptr<cartridge>& nrom) -> void
+{
+    const int passes = 400;
+    const int writes = 1 << 22;
+
+    std::vector<uint8_t> prg(8 * 0x4000);
+    std::vector<uint8_t> chr(0x2000);
+    mapper::memory memory {prg.data(), static_cast<int>(prg.size()), chr.data(), static_cast<int>(chr.size()), true, false};
+
+    auto open = [](const std::string& name, int mapper_number, int prg_banks, int chr_banks) {
+        // The image stays mapped once the file is gone
+        test_rom rom("CygNES_bench_" + name + ".nes", mapper_number, prg_banks, chr_banks);
+        fill_test_rom(rom);
+
+        std::shared_ptr<cartridge> cart = std::make_shared<cartridge>();
+        return cart->open_rom_file(rom.write()) ? cart : nullptr;
+    };
+    auto board = [&](int number) { return discrete_mapper(memory, *discrete_mapper::find(number)); };
+
+    struct candidate
+    {
+        const char* name;
+        std::unique_ptr<virtual_mapper> virtual_version;
+        std::variant<mapper000, mapper001, mapper004, discrete_mapper> variant_version;
+        std::shared_ptr<cartridge> cart;
+    };
+
+    candidate candidates[] = {
+        {"NROM (0)", std::make_unique<virtual_wrapper<mapper000>>(mapper000(memory)), mapper000(memory), nrom},
+        {"MMC1 (1)", std::make_unique<virtual_wrapper<mapper001>>(mapper001(memory)), mapper001(memory), open("mmc1", 1, 16, 16)},
+        {"MMC3 (4)", std::make_unique<virtual_wrapper<mapper004>>(mapper004(memory)), mapper004(memory), open("mmc3", 4, 8, 8)},
+        {"UxROM (2)", std::make_unique<virtual_wrapper<discrete_mapper>>(board(2)), board(2), open("uxrom", 2, 8, 0)},
+        {"CNROM (3)", std::make_unique<virtual_wrapper<discrete_mapper>>(board(3)), board(3), open("cnrom", 3, 2, 4)},
+        {"AxROM (7)", std::make_unique<virtual_wrapper<discrete_mapper>>(board(7)), board(7), open("axrom", 7, 8, 0)},
+        {"Color Dreams (11)", std::make_unique<virtual_wrapper<discrete_mapper>>(board(11)), board(11), open("color_dreams", 11, 8, 16)},
+        {"GxROM (66)", std::make_unique<virtual_wrapper<discrete_mapper>>(board(66)), board(66), open("gxrom", 66, 8, 4)},
+    };
+
+    for (candidate& test : candidates)
+    {
+        if (test.cart == nullptr)
+        {
+            return;
+        }
+
+        uint32_t sum = 0;
+
+        // Every byte of PRG and CHR through the bank windows, as the CPU and
+        // PPU read them
+        cartridge& cart = *test.cart;
+        auto start = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            for (int addr = 0x8000; addr <= 0xFFFF; ++addr)
+            {
+                uint8_t byte = 0;
+                cart.cpu_read(static_cast<uint16_t>(addr), byte);
+                sum += byte;
+            }
+            for (int addr = 0x0000; addr <= 0x1FFF; ++addr)
+            {
+                uint8_t byte = 0;
+                cart.ppu_read(static_cast<uint16_t>(addr), byte);
+                sum += byte;
+            }
+        }
+        std::chrono::duration<double, std::nano> read_time = std::chrono::steady_clock::now() - start;
+
+        // Bank switches, which are all that still reach the mapper
+        virtual_mapper& virtual_version = *test.virtual_version;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < writes; ++i)
+        {
+            virtual_version.cpu_write(static_cast<uint16_t>(0x8000 | i), static_cast<uint8_t>(i));
+        }
+        std::chrono::duration<double, std::nano> virtual_time = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < writes; ++i)
+        {
+            std::visit([&](auto& m) { m.cpu_write(static_cast<uint16_t>(0x8000 | i), static_cast<uint8_t>(i)); },
+                       test.variant_version);
+        }
+        std::chrono::duration<double, std::nano> variant_time = std::chrono::steady_clock::now() - start;
+
+        printf("%-17s %5.2f ns/byte read through the bank windows, %5.2f ns/write virtual, %5.2f ns/write std::visit (%u)\n",
+               test.name,
+               read_time.count() / (passes * (0x8000 + 0x2000)),
+               virtual_time.count() / writes,
+               variant_time.count() / writes,
+               sum & 1);
+    }
+}
+
+// Games reload MMC1 registers a bit at a time, sometimes thousands of times a
+// frame, so its write path is timed on its own: through the cartridge as the
+// CPU sees it, for loads that switch banks and ones that change nothing
+static auto bench_mmc1_writes() -> void
+{
+    const int loads = 1 << 20;
+
+    test_rom rom("CygNES_bench_mmc1.nes", 1, 16, 16);
+    fill_test_rom(rom);
+
+    std::shared_ptr<cartridge> cart = std::make_shared<cartridge>();
+    if (!cart->open_rom_file(rom.write()))
+    {
+        return;
+    }
+
+    auto time_loads = [&](auto&& value_of) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < loads; ++i)
+        {
+            // $A000, $C000 and $E000 in turn: CHR 0, CHR 1 and PRG
+            uint16_t addr = static_cast<uint16_t>(0xA000 + (i % 3) * 0x2000);
+            uint8_t value = value_of(i);
+            for (int bit = 0; bit < 5; ++bit)
+            {
+                cart->cpu_write(addr, static_cast<uint8_t>(value >> bit));
+            }
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+        return elapsed.count() / (loads * 5);
+    };
+
+    double switching = time_loads([](int i) { return static_cast<uint8_t>((i / 3) & 0x0F); });
+    double unchanged = time_loads([](int) { return static_cast<uint8_t>(0); });
+
+    uint8_t byte = 0;
+    cart->cpu_read(0x8000, byte);
+
+    printf("MMC1 register writes: %5.2f ns/write switching banks, %5.2f ns/write unchanged (%u)\n", switching, unchanged, byte & 1);
+}
+
+// MMC3's IRQ counter is clocked by the PPU on one scheduled dot per line
+// rather than by watching its bus, so a game using it for a status bar split
+// should render as fast as one on NROM
+static auto bench_mmc3_irq(std::shared_ptr<cartridge>& nrom) -> void
+{
+    const int frames = 240;
+
+    test_rom rom("CygNES_bench_mmc3.nes", 4, 8, 8);
+    fill_test_rom(rom);
+
+    std::shared_ptr<cartridge> mmc3 = std::make_shared<cartridge>();
+    if (!mmc3->open_rom_file(rom.write()))
+    {
+        return;
+    }
+
+    // An IRQ every 8 lines
+    mmc3->cpu_write(0xC000, 7);
+    mmc3->cpu_write(0xC001, 0);
+    mmc3->cpu_write(0xE001, 0);
+
+    for (std::shared_ptr<cartridge>* cart : {&nrom, &mmc3})
+    {
+        ppu PPU;
+        PPU.connect_cartridge(*cart);
+        PPU.reset();
+        setup_ppu(PPU);
+
+        // Sprites at $1000, so MMC3 sees an A12 edge every line
+        PPU.reg_write(0x00, 0x08);
+
+        printf("%s: %10.1f us/frame\n", cart == &nrom ? "NROM" : "MMC3 with scanline IRQs", run_frames(PPU, frames));
+    }
+}
+
+// Batch jobs start many consoles on one game: after the first, a cartridge
+// is a cache lookup plus its own bank registers and CHR-RAM
+static auto bench_rom_cache() -> void
+{
+    const int cartridges = 1000;
+
+    test_rom rom("CygNES_bench_uxrom.nes", 2, 8, 0);
+    fill_test_rom(rom);
+    const std::string& path = rom.write();
+    std::vector<std::unique_ptr<cartridge>> carts;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < cartridges; ++i)
+    {
+        carts.push_back(std::make_unique<cartridge>());
+        carts.back()->open_rom_file(path);
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+    printf("%d cartridges on one ROM: %6.2f us each, %d image(s) loaded, %zu bytes of state each + %zu of RAM\n",
+           cartridges,
+           elapsed.count() / cartridges,
+           rom_image::cached_count(),
+           sizeof(cartridge),
+           carts.back()->ram_size());
+}
+
+auto main() -> int
+{
+    test_rom rom("CygNES_bench.nes", 0, 1, 1);
+    fill_test_rom(rom);
+
+    std::shared_ptr<cartridge> cart = std::make_shared<cartridge>();
+    if (!cart->open_rom_file(rom.write()))
+    {
+        return 1;
+    }
+
+    bench_frame_skip(cart);
+    bench_frame_formats(cart);
+    bench_static_frames(cart);
+    bench_pipeline(cart);
+    bench_scanline_renderer(cart);
+    bench_ntsc_filter();
+    bench_upscalers();
+    bench_surface_blitter();
+    bench_mapper_dispatch(cart);
+    bench_mmc1_writes();
+    bench_mmc3_irq(cart);
+    bench_rom_cache();
+
+    return 0;
+}
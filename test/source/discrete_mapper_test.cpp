@@ -0,0 +1,98 @@
+#include <cstdio>
+#include <string>
+
+#include "cartridge.hpp"
+#include "test_fixtures.hpp"
+
+// Checks each board in the discrete-logic table against what the real board
+// does with one latch write: which PRG and CHR banks show up, the one-screen
+// page where the board has one, and whether a write the ROM disagrees with
+// gets ANDed with it (bus conflicts).
+
+// Every byte of each 8 KB PRG bank and 1 KB CHR bank holds its bank number,
+// apart from the last page of each 16 KB of PRG, which is all $FF so writes
+// there latch what was written whether or not the board has bus conflicts
+static auto fill_test_rom(test_rom& rom) -> void
+{
+    for (int i = 0; i < rom.prg_size(); ++i)
+    {
+        rom.prg()[i] = static_cast<char>((i & 0x3F00) == 0x3F00 ? 0xFF : i / 0x2000);
+    }
+    for (int i = 0; i < rom.chr_size(); ++i)
+    {
+        rom.chr()[i] = static_cast<char>(i / 0x400);
+    }
+}
+
+struct board_case
+{
+    const char* name;
+    int mapper_number;
+    int prg_banks;
+    int chr_banks;
+
+    uint8_t latch;
+
+    // 8 KB PRG banks at $8000 and $C000, the 1 KB CHR bank at $0000, and
+    // where $2000 lands in VRAM afterwards
+    int prg_8000;
+    int prg_c000;
+    int chr_0000;
+    int nametable_2000;
+
+    bool bus_conflicts;
+};
+
+static const board_case cases[] = {
+    {"UxROM", 2, 8, 0, 0x05, 10, 14, 0, 0x000, true},
+    {"CNROM", 3, 2, 4, 0x02, 0, 2, 16, 0x000, true},
+    {"AxROM", 7, 8, 0, 0x12, 8, 10, 0, 0x400, false},
+    {"Color Dreams", 11, 8, 16, 0x31, 4, 6, 24, 0x000, false},
+    {"GxROM", 66, 8, 4, 0x21, 8, 10, 8, 0x000, true},
+};
+
+auto main() -> int
+{
+    for (const board_case& test : cases)
+    {
+        test_rom rom(std::string("discrete_mapper_test_") + test.name + ".nes", test.mapper_number, test.prg_banks, test.chr_banks);
+        fill_test_rom(rom);
+
+        cartridge cart;
+        if (!cart.open_rom_file(rom.write()))
+        {
+            printf("%s: ROM wasn't accepted\n", test.name);
+            failures++;
+            continue;
+        }
+
+        uint8_t prg_8000 = 0xFF;
+        uint8_t prg_c000 = 0xFF;
+        uint8_t chr_0000 = 0xFF;
+
+        // $FF00 reads $FF in every bank
+        cart.cpu_write(0xFF00, test.latch);
+        cart.cpu_read(0x8000, prg_8000);
+        cart.cpu_read(0xC000, prg_c000);
+        cart.ppu_read(0x0000, chr_0000);
+
+        std::string board = test.name;
+        check(board + ", PRG at $8000", prg_8000, test.prg_8000);
+        check(board + ", PRG at $C000", prg_c000, test.prg_c000);
+        check(board + ", CHR at $0000", chr_0000, test.chr_0000);
+        check(board + ", $2000 in VRAM", cart.nametable_offset(0x2000), test.nametable_2000);
+
+        // A write of exactly the bits the ROM doesn't have there latches 0
+        // on a board with bus conflicts, and switches away from bank 0 on
+        // the rest
+        cart.cpu_write(0x8000, static_cast<uint8_t>(~prg_8000));
+        cart.cpu_read(0x8000, prg_8000);
+        cart.ppu_read(0x0000, chr_0000);
+
+        check(board + ", bus conflicts", prg_8000 == 0 and chr_0000 == 0, test.bus_conflicts);
+    }
+
+    printf("%d failure(s)\n", failures);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+#include <cstdio>
+#include <initializer_list>
+
+#include "ines_header.hpp"
+#include "test_fixtures.hpp"
+
+// Decodes hand-made headers covering both formats and the encodings that
+// have tripped loaders up: NES 2.0's high size nibbles and exponent sizes,
+// RAM shift counts, and old iNES files with junk in the padding.
+
+static auto make_header(std::initializer_list<uint8_t> bytes_4_to_15) -> ines_header
+{
+    uint8_t bytes[ines_header::size] = {'N', 'E', 'S', 0x1A};
+
+    int i = 4;
+    for (uint8_t byte : bytes_4_to_15)
+    {
+        bytes[i++] = byte;
+    }
+
+    ines_header header;
+    if (!header.decode(bytes))
+    {
+        printf("header with bytes 4-15 given wasn't accepted\n");
+        failures++;
+    }
+
+    return header;
+}
+
+auto main() -> int
+{
+    // Plain iNES: MMC1, 128 KB PRG, CHR-RAM, battery, vertical mirroring
+    ines_header ines = make_header({8, 0, 0x13, 0x10, 0, 0, 0, 0, 0, 0, 0, 0});
+    check("iNES nes2", ines.nes2, false);
+    check("iNES mapper", ines.mapper, 0x11);
+    check("iNES PRG-ROM", static_cast<long long>(ines.prg_rom_size), 128 * 1024);
+    check("iNES CHR-ROM", static_cast<long long>(ines.chr_rom_size), 0);
+    check("iNES PRG-RAM", ines.prg_ram_size, 0);
+    check("iNES PRG-NVRAM", ines.prg_nvram_size, 8 * 1024);
+    check("iNES CHR-RAM", ines.chr_ram_size, 8 * 1024);
+    check("iNES mirroring", ines.vertical_mirroring, true);
+    check("iNES PRG offset", static_cast<long long>(ines.prg_rom_offset()), 16);
+
+    // A dumper's name in the padding: byte 7's mapper bits can't be trusted
+    ines_header dirty = make_header({2, 1, 0x40, 'D', 'i', 's', 'k', 'D', 'u', 'd', 'e', '!'});
+    check("dirty iNES mapper", dirty.mapper, 4);
+
+    // NES 2.0: mapper 4.1 + 256, 12-bit sizes, RAM by shift count, PAL
+    ines_header nes2 = make_header({0x00, 0x01, 0x44, 0x08, 0x11, 0x21, 0x70, 0x07, 0x01, 0, 0, 0});
+    check("NES 2.0 nes2", nes2.nes2, true);
+    check("NES 2.0 mapper", nes2.mapper, 0x104);
+    check("NES 2.0 submapper", nes2.submapper, 1);
+    check("NES 2.0 PRG-ROM", static_cast<long long>(nes2.prg_rom_size), 0x100 * 0x4000LL);
+    check("NES 2.0 CHR-ROM", static_cast<long long>(nes2.chr_rom_size), 0x201 * 0x2000LL);
+    check("NES 2.0 PRG-RAM", nes2.prg_ram_size, 0);
+    check("NES 2.0 PRG-NVRAM", nes2.prg_nvram_size, 64 << 7);
+    check("NES 2.0 CHR-RAM", nes2.chr_ram_size, 64 << 7);
+    check("NES 2.0 trainer", static_cast<long long>(nes2.prg_rom_offset()), 16 + 512);
+    check("NES 2.0 timing", static_cast<int>(nes2.region), static_cast<int>(ines_header::timing::pal));
+
+    // NES 2.0 exponent-multiplier sizes: 2^10 * 3 bytes of PRG
+    ines_header odd = make_header({(10 << 2) | 1, 0, 0, 0x08, 0, 0x0F, 0, 0, 0, 0, 0, 0});
+    check("exponent PRG-ROM", static_cast<long long>(odd.prg_rom_size), 3 * 1024);
+
+    uint8_t bad[ines_header::size] = {'N', 'O', 'P', 0x1A};
+    ines_header rejected;
+    check("bad magic accepted", rejected.decode(bad), false);
+
+    printf("%d failures\n", failures);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+#include <array>
+#include <cstdio>
+#include <vector>
+
+#include "discrete_mapper.hpp"
+#include "mapper000.hpp"
+#include "mapper001.hpp"
+#include "mapper004.hpp"
+
+// Checks that every mapper moves the generation of exactly the windows a
+// register write repoints (and of every CHR window showing the byte a
+// CHR-RAM write changes), and leaves the rest alone, including on writes
+// that switch nothing.
+
+static int failures = 0;
+
+// PRG windows are bits 0-3, CHR windows bits 4-11
+static auto window_generations(const mapper& banks) -> std::array<uint32_t, 12>
+{
+    std::array<uint32_t, 12> generations {};
+
+    for (int window = 0; window < mapper::prg_window_count; ++window)
+    {
+        generations[window] = banks.prg_generation(window);
+    }
+    for (int window = 0; window < mapper::chr_window_count; ++window)
+    {
+        generations[mapper::prg_window_count + window] = banks.chr_generation(window);
+    }
+
+    return generations;
+}
+
+template <typename Mapper, typename Action>
+static auto check(const char* what, Mapper& banks, Action action, int expected) -> void
+{
+    std::array<uint32_t, 12> before = window_generations(banks);
+    uint32_t generation = banks.generation();
+
+    action(banks);
+
+    std::array<uint32_t, 12> after = window_generations(banks);
+    int moved = 0;
+    bool behind = false;
+
+    for (size_t window = 0; window < after.size(); ++window)
+    {
+        if (after[window] != before[window])
+        {
+            moved |= 1 << window;
+        }
+        behind = behind or after[window] > banks.generation();
+    }
+
+    if (moved != expected or behind or (moved != 0) != (banks.generation() != generation))
+    {
+        printf("%s: windows %03X moved, expected %03X (generation %u -> %u)\n",
+               what,
+               moved,
+               expected,
+               generation,
+               banks.generation());
+        failures++;
+    }
+}
+
+static auto write(uint16_t addr, uint8_t byte)
+{
+    return [=](auto& banks) { banks.cpu_write(addr, byte); };
+}
+
+// MMC1 registers take five writes
+static auto load(uint16_t addr, uint8_t value)
+{
+    return [=](mapper001& banks) {
+        for (int bit = 0; bit < 5; ++bit)
+        {
+            banks.cpu_write(addr, static_cast<uint8_t>(value >> bit));
+        }
+    };
+}
+
+static const int all_prg = 0x00F;
+static const int all_chr = 0xFF0;
+
+auto main() -> int
+{
+    // PRG is all $FF so bus conflicts never get in the way
+    std::vector<uint8_t> prg(16 * 0x4000, 0xFF);
+    std::vector<uint8_t> chr(16 * 0x2000);
+    std::vector<uint8_t> chr_ram(0x2000);
+
+    mapper::memory rom {prg.data(), static_cast<int>(prg.size()), chr.data(), static_cast<int>(chr.size()), false, false};
+    mapper::memory ram {prg.data(), static_cast<int>(prg.size()), chr_ram.data(), static_cast<int>(chr_ram.size()), true, false};
+
+    mapper000 nrom(ram);
+    check("NROM, register write", nrom, write(0x8000, 0x55), 0);
+    check("NROM, CHR-RAM write", nrom, [](mapper& banks) { banks.chr_write(0x0400, 0x12); }, 0x020);
+    check("NROM, same CHR-RAM byte", nrom, [](mapper& banks) { banks.chr_write(0x0400, 0x12); }, 0);
+
+    // Writes reach every window showing the page, not just the one written
+    // through: 4 KB of CHR-RAM wraps into both pattern tables
+    std::vector<uint8_t> small_chr_ram(0x1000);
+    mapper::memory small_ram {prg.data(), static_cast<int>(prg.size()), small_chr_ram.data(), static_cast<int>(small_chr_ram.size()), true, false};
+    mapper000 wrapped(small_ram);
+    check("NROM, 4 KB CHR-RAM write", wrapped, [](mapper& banks) { banks.chr_write(0x1800, 0x56); }, 0x440);
+
+    // ...and MMC1 in 4 KB mode can put the same bank in both
+    mapper001 mmc1_ram(ram);
+    check("MMC1, 4 KB CHR mode on CHR-RAM", mmc1_ram, load(0x8000, 0x1C), 0xF00);
+    check("MMC1, same CHR-RAM bank twice", mmc1_ram, load(0xC000, 0), 0);
+    check("MMC1, CHR-RAM write to both", mmc1_ram, [](mapper& banks) { banks.chr_write(0x0400, 0x78); }, 0x220);
+
+    mapper001 mmc1(rom);
+    check("MMC1, PRG bank", mmc1, load(0xE000, 3), 0x003);
+    check("MMC1, same PRG bank", mmc1, load(0xE000, 3), 0);
+    check("MMC1, 8 KB CHR bank", mmc1, load(0xA000, 2), all_chr);
+    check("MMC1, mirroring", mmc1, load(0x8000, 0x0D), 0);
+    check("MMC1, PRG mode", mmc1, load(0x8000, 0x09), 0x00F);
+    check("MMC1, 4 KB CHR mode", mmc1, load(0x8000, 0x19), 0xF00);
+    check("MMC1, upper 4 KB CHR bank", mmc1, load(0xC000, 7), 0xF00);
+
+    mapper004 mmc3(rom);
+    check("MMC3, R6", mmc3, [](mapper004& banks) { banks.cpu_write(0x8000, 6); banks.cpu_write(0x8001, 3); }, 0x001);
+    check("MMC3, R2", mmc3, [](mapper004& banks) { banks.cpu_write(0x8000, 2); banks.cpu_write(0x8001, 9); }, 0x100);
+    check("MMC3, same R2", mmc3, write(0x8001, 9), 0);
+    check("MMC3, CHR inversion", mmc3, write(0x8000, 0x80), all_chr);
+    check("MMC3, PRG layout", mmc3, write(0x8000, 0xC0), 0x005);
+    check("MMC3, IRQ and mirroring", mmc3, [](mapper004& banks) { banks.cpu_write(0xA000, 1); banks.cpu_write(0xC000, 8); banks.cpu_write(0xE001, 0); }, 0);
+
+    discrete_mapper uxrom(ram, *discrete_mapper::find(2));
+    check("UxROM, PRG bank", uxrom, write(0x8000, 1), 0x003);
+    check("UxROM, same PRG bank", uxrom, write(0x8000, 1), 0);
+    check("UxROM, CHR-RAM write", uxrom, [](mapper& banks) { banks.chr_write(0x1FFF, 0x34); }, 0x800);
+
+    discrete_mapper cnrom(rom, *discrete_mapper::find(3));
+    check("CNROM, CHR bank", cnrom, write(0x8000, 1), all_chr);
+
+    discrete_mapper axrom(ram, *discrete_mapper::find(7));
+    check("AxROM, PRG bank", axrom, write(0x8000, 1), all_prg);
+    check("AxROM, nametable page", axrom, write(0x8000, 0x11), 0);
+
+    discrete_mapper color_dreams(rom, *discrete_mapper::find(11));
+    check("Color Dreams, PRG and CHR banks", color_dreams, write(0x8000, 0x11), all_prg | all_chr);
+
+    discrete_mapper gxrom(rom, *discrete_mapper::find(66));
+    check("GxROM, PRG bank", gxrom, write(0x8000, 0x10), all_prg);
+    check("GxROM, CHR bank", gxrom, write(0x8000, 0x11), all_chr);
+
+    // A mapper made later, say for the next ROM loaded, never reuses a
+    // stamp, even on windows it hasn't switched
+    mapper000 next_rom(rom);
+    for (uint32_t generation : window_generations(next_rom))
+    {
+        if (generation <= gxrom.generation())
+        {
+            printf("New mapper: window generation %u, last mapper's %u\n", generation, gxrom.generation());
+            failures++;
+        }
+    }
+
+    printf("%d failure(s)\n", failures);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+#include <cstdio>
+#include <memory>
+
+#include "ppu.hpp"
+#include "test_fixtures.hpp"
+
+// Checks MMC3's bank layouts through the cartridge, and that its scanline IRQ
+// goes off on the dot the PPU's fetch schedule puts the A12 edge on, for each
+// arrangement of pattern tables, and not at all when there's no edge to
+// count.
+
+// 128 KB of PRG and 64 KB of CHR, every byte of each 8 KB PRG bank and 1 KB
+// CHR bank holding its bank number
+static auto fill_test_rom(test_rom& rom) -> void
+{
+    for (int i = 0; i < rom.prg_size(); ++i)
+    {
+        rom.prg()[i] = static_cast<char>(i / 0x2000);
+    }
+    for (int i = 0; i < rom.chr_size(); ++i)
+    {
+        rom.chr()[i] = static_cast<char>(i / 0x400);
+    }
+}
+
+static auto prg_bank_at(cartridge& cart, uint16_t addr) -> long long
+{
+    uint8_t byte = 0xFF;
+    cart.cpu_read(addr, byte);
+    return byte;
+}
+
+static auto chr_bank_at(cartridge& cart, uint16_t addr) -> long long
+{
+    uint8_t byte = 0xFF;
+    cart.ppu_read(addr, byte);
+    return byte;
+}
+
+static auto check_banks(cartridge& cart) -> void
+{
+    uint32_t generation = cart.generation();
+
+    const uint8_t registers[8] = {8, 13, 20, 21, 22, 23, 3, 5};
+    for (int i = 0; i < 8; ++i)
+    {
+        cart.cpu_write(0x8000, static_cast<uint8_t>(i));
+        cart.cpu_write(0x8001, registers[i]);
+    }
+
+    // Every window but the fixed last PRG bank was switched
+    check("$A000's generation moved", cart.prg_generation(1) > generation, true);
+    check("$E000's generation moved", cart.prg_generation(3) > generation, false);
+    check("$1C00's generation moved", cart.chr_generation(7) > generation, true);
+
+    check("$8000, R6 at $8000", prg_bank_at(cart, 0x8000), 3);
+    check("$8000, R7 at $A000", prg_bank_at(cart, 0xA000), 5);
+    check("$8000, fixed bank at $C000", prg_bank_at(cart, 0xC000), 14);
+    check("$8000, last bank at $E000", prg_bank_at(cart, 0xFFFF), 15);
+
+    // 2 KB banks ignore R0 and R1's low bit
+    check("$8000, R0 at $0000", chr_bank_at(cart, 0x0000), 8);
+    check("$8000, R0 at $0400", chr_bank_at(cart, 0x0400), 9);
+    check("$8000, R1 at $0800", chr_bank_at(cart, 0x0800), 12);
+    check("$8000, R1 at $0C00", chr_bank_at(cart, 0x0C00), 13);
+    check("$8000, R2 at $1000", chr_bank_at(cart, 0x1000), 20);
+    check("$8000, R5 at $1C00", chr_bank_at(cart, 0x1FFF), 23);
+
+    cart.cpu_write(0x8000, 0xC0);
+
+    check("$80C0, fixed bank at $8000", prg_bank_at(cart, 0x8000), 14);
+    check("$80C0, R7 at $A000", prg_bank_at(cart, 0xA000), 5);
+    check("$80C0, R6 at $C000", prg_bank_at(cart, 0xC000), 3);
+    check("$80C0, last bank at $E000", prg_bank_at(cart, 0xE000), 15);
+    check("$80C0, R2 at $0000", chr_bank_at(cart, 0x0000), 20);
+    check("$80C0, R5 at $0C00", chr_bank_at(cart, 0x0C00), 23);
+    check("$80C0, R0 at $1000", chr_bank_at(cart, 0x1000), 8);
+    check("$80C0, R1 at $1C00", chr_bank_at(cart, 0x1C00), 13);
+
+    cart.cpu_write(0xA000, 0x01);
+    check("horizontal $2400", cart.nametable_offset(0x2400), 0x000);
+    check("horizontal $2800", cart.nametable_offset(0x2800), 0x400);
+    cart.cpu_write(0xA000, 0x00);
+    check("vertical $2400", cart.nametable_offset(0x2400), 0x400);
+    check("vertical $2800", cart.nametable_offset(0x2800), 0x000);
+
+    cart.cpu_write(0x8000, 0x00);
+}
+
+// Runs a frame from the top with the IRQ counter reloading every `latch`
+// lines, acknowledging each IRQ as soon as it's raised, and returns the
+// count; the first one's position goes in first_line and first_dot
+static auto run_frame(ppu& PPU, cartridge& cart, uint8_t ctrl, uint8_t mask, int latch, int& first_line, int& first_dot) -> int
+{
+    ppu::snapshot state {};
+    state.ctrl = ctrl;
+    state.mask = mask;
+    PPU.load_state(state);
+
+    cart.cpu_write(0xC000, static_cast<uint8_t>(latch));
+    cart.cpu_write(0xC001, 0);
+    cart.cpu_write(0xE000, 0);
+    cart.cpu_write(0xE001, 0);
+
+    int irqs = 0;
+    first_line = -1;
+    first_dot = -1;
+
+    for (int dot = 0; dot < ppu::dots_per_line * ppu::lines_per_frame; ++dot)
+    {
+        PPU.step();
+
+        if (cart.irq())
+        {
+            if (irqs == 0)
+            {
+                PPU.save_state(state);
+                first_line = state.scanline;
+                first_dot = state.pixel - 1;
+            }
+            irqs++;
+
+            cart.cpu_write(0xE000, 0);
+            cart.cpu_write(0xE001, 0);
+        }
+    }
+
+    return irqs;
+}
+
+auto main() -> int
+{
+    test_rom rom("mmc3_test.nes", 4, 8, 8);
+    fill_test_rom(rom);
+
+    std::shared_ptr<cartridge> cart = std::make_shared<cartridge>();
+    if (!cart->open_rom_file(rom.write()))
+    {
+        return 1;
+    }
+
+    check_banks(*cart);
+
+    std::shared_ptr<frame_buffer> frames = std::make_shared<frame_buffer>();
+    ppu PPU;
+    PPU.connect_cartridge(cart);
+    PPU.connect_frame_buffer(frames);
+
+    int line = 0;
+    int dot = 0;
+
+    // Background at $0000, sprites at $1000: the counter loads on line 0
+    // and reaches zero ten lines later, at the first sprite fetch. Lines 0
+    // to 239 and the pre-render line all count.
+    int irqs = run_frame(PPU, *cart, 0x08, 0x18, 10, line, dot);
+    check("sprites at $1000, line", line, 10);
+    check("sprites at $1000, dot", dot, 260);
+    check("sprites at $1000, IRQs", irqs, 241 / 11);
+
+    // Swapped, the edge is the next line's first background fetch
+    irqs = run_frame(PPU, *cart, 0x10, 0x08, 10, line, dot);
+    check("background at $1000, line", line, 10);
+    check("background at $1000, dot", dot, 324);
+    check("background at $1000, IRQs", irqs, 241 / 11);
+
+    // 8x16 sprites count as coming from $1000
+    irqs = run_frame(PPU, *cart, 0x20, 0x10, 0, line, dot);
+    check("8x16 sprites, line", line, 0);
+    check("8x16 sprites, IRQs", irqs, 241);
+
+    // No edge with both on one table, and no fetches with rendering off
+    irqs = run_frame(PPU, *cart, 0x18, 0x18, 10, line, dot);
+    check("both at $1000, IRQs", irqs, 0);
+    irqs = run_frame(PPU, *cart, 0x08, 0x00, 10, line, dot);
+    check("rendering off, IRQs", irqs, 0);
+
+    // Disabled, the counter still runs but the line stays low
+    ppu::snapshot state {};
+    state.ctrl = 0x08;
+    state.mask = 0x18;
+    PPU.load_state(state);
+    cart->cpu_write(0xC000, 1);
+    cart->cpu_write(0xC001, 0);
+    cart->cpu_write(0xE000, 0);
+    for (int i = 0; i < ppu::dots_per_line * ppu::lines_per_frame; ++i)
+    {
+        PPU.step();
+    }
+    check("disabled, IRQ line", cart->irq(), false);
+
+    printf("%d failure(s)\n", failures);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "ppu.hpp"
+#include "test_fixtures.hpp"
+
+// Checks that a frame drawn on the render thread, whole or in bands of
+// scanlines, comes out exactly as it does drawn in place while the game
+// switches CHR banks and mirroring mid-frame and writes CHR-RAM during
+// vblank: the replicas have to draw each line with the cartridge as it was
+// when the line was drawn, not as it is when they get to it.
+
+// PRG is all $FF, so bus conflicts never get in the way; every 1 KB of CHR
+// holds a different pattern
+static auto fill_test_rom(test_rom& rom) -> void
+{
+    for (int i = 0; i < rom.prg_size(); ++i)
+    {
+        rom.prg()[i] = static_cast<char>(0xFF);
+    }
+    for (int i = 0; i < rom.chr_size(); ++i)
+    {
+        rom.chr()[i] = static_cast<char>(i * 37 + (i / 0x400) * 91);
+    }
+}
+
+struct game
+{
+    const char* name;
+    int mapper_number;
+    int prg_banks;
+    int chr_banks;
+
+    // What the game does to the cartridge on the given dot of a frame
+    void (*on_dot)(ppu& PPU, cartridge& cart, int frame, int dot);
+};
+
+static const game games[] = {
+    {"CNROM", 3, 2, 4,
+     [](ppu&, cartridge& cart, int frame, int dot) {
+         if (dot == 60 * ppu::dots_per_line + 300 or dot == 150 * ppu::dots_per_line + 300)
+         {
+             cart.cpu_write(0xFFFF, static_cast<uint8_t>((frame + dot / ppu::dots_per_line) & 0x03));
+         }
+     }},
+    {"MMC3", 4, 8, 8,
+     [](ppu&, cartridge& cart, int frame, int dot) {
+         if (dot == 100 * ppu::dots_per_line + 300)
+         {
+             cart.cpu_write(0x8000, 0x00);
+             cart.cpu_write(0x8001, static_cast<uint8_t>(frame * 2));
+             cart.cpu_write(0xA000, static_cast<uint8_t>(frame & 0x01));
+         }
+     }},
+    {"UxROM", 2, 2, 0,
+     [](ppu& PPU, cartridge&, int frame, int dot) {
+         if (dot == 245 * ppu::dots_per_line)
+         {
+             PPU.reg_write(0x06, static_cast<uint8_t>(frame & 0x1F));
+             PPU.reg_write(0x06, 0x10);
+             for (int i = 0; i < 64; ++i)
+             {
+                 PPU.reg_write(0x07, static_cast<uint8_t>(frame * 13 + i));
+             }
+         }
+     }},
+};
+
+// Runs a few frames of the game with pixels drawn in place (band_workers
+// -1), on the render thread, or in bands on that many more threads, and
+// returns a hash of the last one
+static auto last_frame(const game& test, int band_workers) -> uint64_t
+{
+    test_rom rom(std::string("pipeline_test_") + test.name + ".nes", test.mapper_number, test.prg_banks, test.chr_banks);
+    fill_test_rom(rom);
+
+    std::shared_ptr<cartridge> cart = std::make_shared<cartridge>();
+    if (!cart->open_rom_file(rom.write()))
+    {
+        printf("%s: ROM wasn't accepted\n", test.name);
+        failures++;
+        return 0;
+    }
+
+    std::shared_ptr<frame_buffer> frames = std::make_shared<frame_buffer>();
+    ppu PPU;
+    PPU.connect_cartridge(cart);
+    PPU.connect_frame_buffer(frames);
+    PPU.reset();
+
+    PPU.reg_write(0x06, 0x20);
+    PPU.reg_write(0x06, 0x00);
+    for (int i = 0; i < 0x800; ++i)
+    {
+        PPU.reg_write(0x07, static_cast<uint8_t>(i * 7));
+    }
+    PPU.reg_write(0x06, 0x3F);
+    PPU.reg_write(0x06, 0x00);
+    for (int i = 0; i < 0x20; ++i)
+    {
+        PPU.reg_write(0x07, static_cast<uint8_t>(i * 5));
+    }
+    PPU.reg_write(0x01, 0x0A);
+
+    if (band_workers >= 0)
+    {
+        PPU.set_pipelined(true, band_workers);
+    }
+
+    // As the CPU does, tell the PPU whenever the mapper moves something it
+    // can't see
+    uint32_t generation = cart->ppu_generation();
+
+    for (int frame = 0; frame < 8; ++frame)
+    {
+        for (int dot = 0; dot < ppu::dots_per_line * ppu::lines_per_frame; ++dot)
+        {
+            PPU.step();
+            test.on_dot(PPU, *cart, frame, dot);
+
+            if (cart->ppu_generation() != generation)
+            {
+                generation = cart->ppu_generation();
+                PPU.invalidate_frame();
+            }
+        }
+    }
+
+    // Waits for the render thread to draw what it was given
+    PPU.set_pipelined(false);
+
+    uint64_t hash = 0xCBF29CE484222325;
+    if (frames->acquire())
+    {
+        const uint32_t* pixels = frames->front();
+        for (int i = 0; i < frame_buffer::pixel_count; ++i)
+        {
+            hash = (hash ^ pixels[i]) * 0x100000001B3;
+        }
+    }
+
+    return hash;
+}
+
+auto main() -> int
+{
+    for (const game& test : games)
+    {
+        uint64_t in_place = last_frame(test, -1);
+
+        for (int band_workers : {0, 2})
+        {
+            uint64_t pipelined = last_frame(test, band_workers);
+            if (pipelined != in_place)
+            {
+                printf("%s, %d band workers: frame %016llx, drawn in place %016llx\n",
+                       test.name,
+                       band_workers,
+                       static_cast<unsigned long long>(pipelined),
+                       static_cast<unsigned long long>(in_place));
+                failures++;
+            }
+        }
+    }
+
+    printf("%d failure(s)\n", failures);
+
+    return failures == 0 ? 0 : 1;
+}
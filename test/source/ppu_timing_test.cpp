@@ -0,0 +1,143 @@
+#include <cstdio>
+#include <memory>
+
+#include "ppu.hpp"
+#include "test_fixtures.hpp"
+
+// Checks the PPU's dot-by-dot behavior against a trace recorded before its
+// per-dot schedule became a lookup table: every register, latch, shifter and
+// the beam position are hashed after every single dot, across frames with
+// rendering on and off and with writes landing mid-line.
+
+// Recorded with the original nested-switch schedule, then again (and only
+// then) when horizontal mirroring stopped putting $2800 in $2000's page
+static const uint64_t expected_trace = 0xD63678D09D1508A3ULL;
+
+// CHR is a function of each byte's offset in the file, as it was when the
+// trace was recorded
+static auto fill_test_rom(test_rom& rom) -> void
+{
+    for (int i = 0; i < rom.chr_size(); ++i)
+    {
+        size_t offset = test_rom::header_size + rom.prg_size() + i;
+        rom.chr()[i] = static_cast<char>(offset * 37 + (offset >> 5));
+    }
+}
+
+static auto mix(uint64_t hash, uint64_t value) -> uint64_t
+{
+    return (hash ^ value) * 0x100000001B3;
+}
+
+static auto hash_state(uint64_t hash, const ppu::snapshot& state) -> uint64_t
+{
+    hash = mix(hash, state.ctrl | (state.mask << 8) | (state.status << 16) | (state.latch << 24));
+    hash = mix(hash, state.vram_addr | (state.temp_addr << 16) | (static_cast<uint64_t>(state.fine_x) << 32));
+    hash = mix(hash, state.nt_byte | (state.attr_byte << 8) | (state.pattern_low << 16) | (state.pattern_high << 24));
+    hash = mix(hash, state.p_shift_low | (state.p_shift_high << 16));
+    hash = mix(hash, state.a_shift_low | (state.a_shift_high << 16));
+    hash = mix(hash, state.scanline * 1000 + state.pixel);
+    return hash;
+}
+
+auto main() -> int
+{
+    test_rom rom("ppu_timing_test.nes", 0, 1, 1);
+    fill_test_rom(rom);
+
+    std::shared_ptr<cartridge> cart = std::make_shared<cartridge>();
+    if (!cart->open_rom_file(rom.write()))
+    {
+        return 1;
+    }
+
+    std::shared_ptr<frame_buffer> frames = std::make_shared<frame_buffer>();
+    ppu PPU;
+    PPU.connect_cartridge(cart);
+    PPU.connect_frame_buffer(frames);
+
+    // Start from a fully defined state
+    ppu::snapshot state {};
+    PPU.load_state(state);
+
+    PPU.reg_write(0x06, 0x20);
+    PPU.reg_write(0x06, 0x00);
+    for (int i = 0; i < 0x800; ++i)
+    {
+        PPU.reg_write(0x07, static_cast<uint8_t>(i * 11 + (i >> 6)));
+    }
+    PPU.reg_write(0x06, 0x3F);
+    PPU.reg_write(0x06, 0x00);
+    for (int i = 0; i < 0x20; ++i)
+    {
+        PPU.reg_write(0x07, static_cast<uint8_t>(i * 5));
+    }
+    PPU.reg_write(0x00, 0x90);
+
+    const int frames_to_run = 6;
+    const int dots_per_frame = ppu::dots_per_line * ppu::lines_per_frame;
+    uint64_t trace = 0xCBF29CE484222325;
+    uint64_t interrupts = 0;
+
+    for (int frame = 0; frame < frames_to_run; ++frame)
+    {
+        for (int dot = 0; dot < dots_per_frame; ++dot)
+        {
+            // Rendering off for the first frame, then on, with scroll and
+            // mask writes landing mid-line on a few frames
+            if (dot == 0)
+            {
+                PPU.reg_write(0x01, frame == 0 ? 0x00 : 0x0A);
+                PPU.reg_write(0x05, static_cast<uint8_t>(frame * 13));
+                PPU.reg_write(0x05, static_cast<uint8_t>(frame * 7));
+            }
+            if (frame >= 3 and dot == 100 * ppu::dots_per_line + 130)
+            {
+                PPU.reg_write(0x05, 0x23);
+                PPU.reg_write(0x05, 0x45);
+            }
+            if (frame == 4 and dot == 150 * ppu::dots_per_line + 40)
+            {
+                PPU.reg_write(0x01, 0x00);
+            }
+            if (frame == 4 and dot == 160 * ppu::dots_per_line + 300)
+            {
+                PPU.reg_write(0x01, 0x0A);
+            }
+            if (frame == 5 and dot == 200 * ppu::dots_per_line + 7)
+            {
+                PPU.reg_read(0x02);
+                PPU.reg_write(0x06, 0x24);
+                PPU.reg_write(0x06, 0x10);
+            }
+
+            PPU.step();
+
+            if (PPU.interr())
+            {
+                interrupts++;
+            }
+
+            PPU.save_state(state);
+            trace = hash_state(trace, state);
+        }
+
+        if (frames->acquire())
+        {
+            const uint32_t* pixels = frames->front();
+            for (int i = 0; i < frame_buffer::pixel_count; ++i)
+            {
+                trace = mix(trace, pixels[i]);
+            }
+        }
+    }
+
+    trace = mix(trace, interrupts);
+
+    printf("trace %016llx (expected %016llx), %llu NMIs\n",
+           static_cast<unsigned long long>(trace),
+           static_cast<unsigned long long>(expected_trace),
+           static_cast<unsigned long long>(interrupts));
+
+    return trace == expected_trace ? 0 : 1;
+}
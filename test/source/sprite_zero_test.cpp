@@ -0,0 +1,196 @@
+#include <cstdio>
+#include <memory>
+
+#include "ppu.hpp"
+#include "test_fixtures.hpp"
+
+// Checks that frames which aren't drawn (and so only predict sprite 0 hit)
+// raise the flag on exactly the same dot as drawn frames, which test it
+// against every background pixel. Each scenario is a pseudo-random sprite 0,
+// scroll, clipping and set of tiles, some with a write landing mid-frame.
+
+static const int scenario_count = 64;
+static const int frames_per_scenario = 3;
+
+static uint32_t seed = 0x2C9277B5;
+
+static auto next_random() -> uint32_t
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed >> 8;
+}
+
+static auto fill_test_rom(test_rom& rom) -> void
+{
+    // Sparse bitplanes, with every fourth tile left empty, so there's plenty
+    // of transparency on both sides
+    for (int tile = 0; tile < 0x200; ++tile)
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            uint32_t bits = tile % 4 == 0 ? 0 : next_random() & next_random();
+            rom.chr()[tile * 16 + i] = static_cast<char>(bits);
+        }
+    }
+}
+
+struct scenario
+{
+    uint8_t oam[4];
+    uint8_t ctrl;
+    uint8_t mask;
+    uint8_t scroll_x;
+    uint8_t scroll_y;
+
+    // A register write partway down the frame, if reg isn't 0xFF
+    int write_dot;
+    uint8_t reg;
+    uint8_t byte;
+};
+
+static auto make_scenario() -> scenario
+{
+    scenario test = {};
+
+    test.oam[0] = static_cast<uint8_t>(next_random() % 240);
+    test.oam[1] = static_cast<uint8_t>(next_random());
+    test.oam[2] = static_cast<uint8_t>(next_random() & 0xC0);
+    test.oam[3] = static_cast<uint8_t>(next_random() % 8 == 0 ? 248 + next_random() % 8 : next_random());
+
+    test.ctrl = static_cast<uint8_t>(next_random() & 0x3B);
+    test.mask = static_cast<uint8_t>(0x18 | (next_random() & 0x06));
+    test.scroll_x = static_cast<uint8_t>(next_random());
+    test.scroll_y = static_cast<uint8_t>(next_random() % 240);
+
+    test.reg = 0xFF;
+    if (next_random() % 2 == 0)
+    {
+        static const uint8_t regs[] = {0x00, 0x01, 0x05, 0x06, 0x07};
+
+        // On sprite 0's first line, ahead of it, where it can matter
+        int line = test.oam[0] + 1;
+        test.write_dot = line * ppu::dots_per_line + 1 + static_cast<int>(next_random() % (test.oam[3] + 1));
+        test.reg = regs[next_random() % 5];
+        test.byte = static_cast<uint8_t>(next_random());
+        if (test.reg == 0x01)
+        {
+            test.byte &= 0x1E;
+        }
+    }
+
+    return test;
+}
+
+static auto set_up(ppu& PPU, const scenario& test) -> void
+{
+    ppu::snapshot state {};
+    PPU.load_state(state);
+
+    PPU.reg_write(0x06, 0x20);
+    PPU.reg_write(0x06, 0x00);
+    for (int i = 0; i < 0x800; ++i)
+    {
+        PPU.reg_write(0x07, static_cast<uint8_t>(i * 29 + (i >> 3) * 7));
+    }
+
+    for (int i = 0; i < 4; ++i)
+    {
+        PPU.oam_write(static_cast<uint8_t>(i), test.oam[i]);
+    }
+
+    PPU.reg_write(0x00, test.ctrl);
+    PPU.reg_write(0x01, test.mask);
+}
+
+static auto run_dot(ppu& PPU, const scenario& test, int dot) -> uint8_t
+{
+    if (dot == 0)
+    {
+        PPU.reg_read(0x02);
+        PPU.reg_write(0x05, test.scroll_x);
+        PPU.reg_write(0x05, test.scroll_y);
+    }
+    if (test.reg != 0xFF and dot == test.write_dot)
+    {
+        PPU.reg_write(test.reg, test.byte);
+    }
+
+    PPU.step();
+
+    ppu::snapshot state;
+    PPU.save_state(state);
+
+    return state.status & 0x40;
+}
+
+auto main() -> int
+{
+    test_rom rom("sprite_zero_test.nes", 0, 1, 1);
+    fill_test_rom(rom);
+
+    std::shared_ptr<cartridge> cart = std::make_shared<cartridge>();
+    if (!cart->open_rom_file(rom.write()))
+    {
+        return 1;
+    }
+
+    const int dots_per_frame = ppu::dots_per_line * ppu::lines_per_frame;
+    int mismatches = 0;
+    int hits = 0;
+
+    for (int i = 0; i < scenario_count; ++i)
+    {
+        scenario test = make_scenario();
+
+        // One PPU draws every frame; the other only draws the first
+        std::shared_ptr<frame_buffer> drawn_frames = std::make_shared<frame_buffer>();
+        ppu drawn;
+        drawn.connect_cartridge(cart);
+        drawn.connect_frame_buffer(drawn_frames);
+
+        std::shared_ptr<frame_buffer> skipped_frames = std::make_shared<frame_buffer>();
+        ppu skipped;
+        skipped.connect_cartridge(cart);
+        skipped.connect_frame_buffer(skipped_frames);
+        skipped.set_frame_skip(1000);
+
+        set_up(drawn, test);
+        set_up(skipped, test);
+
+        for (int frame = 0; frame < frames_per_scenario; ++frame)
+        {
+            // Otherwise an unchanged frame would be reused, not drawn
+            drawn.invalidate_frame();
+
+            int drawn_hit = -1;
+            int skipped_hit = -1;
+
+            for (int dot = 0; dot < dots_per_frame; ++dot)
+            {
+                if (run_dot(drawn, test, dot) != 0 and drawn_hit < 0)
+                {
+                    drawn_hit = dot;
+                }
+                if (run_dot(skipped, test, dot) != 0 and skipped_hit < 0)
+                {
+                    skipped_hit = dot;
+                }
+            }
+
+            if (drawn_hit != skipped_hit)
+            {
+                printf("scenario %d frame %d: drawn hit on dot %d, predicted on dot %d\n", i, frame, drawn_hit, skipped_hit);
+                mismatches++;
+            }
+            if (drawn_hit >= 0)
+            {
+                hits++;
+            }
+        }
+    }
+
+    printf("%d scenarios, %d frames with a hit, %d mismatches\n", scenario_count, hits, mismatches);
+
+    // A set where nothing ever hits wouldn't prove anything
+    return mismatches == 0 and hits > 0 ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+#ifndef CYGNES_TEST_FIXTURES_HPP
+#define CYGNES_TEST_FIXTURES_HPP
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * What the tests and the bench share: an iNES file to load, and a check that
+ * counts failures.
+ *
+ * A test_rom lays out a header for the mapper and bank counts given, with
+ * PRG and CHR zeroed for the caller to fill in, and write() puts it in the
+ * working directory. The file goes away with the object, so a test that
+ * fails or returns early still leaves nothing behind.
+ */
+class test_rom
+{
+    std::string m_path;
+    std::vector<char> m_image;
+    int m_prg_size;
+    bool m_written = false;
+
+  public:
+    static constexpr int header_size = 16;
+
+    // prg_banks counts 16 KB and chr_banks 8 KB, as the header does; 0 CHR
+    // banks means CHR-RAM
+    test_rom(std::string path, int mapper_number, int prg_banks, int chr_banks)
+        : m_path(std::move(path))
+        , m_image(header_size + prg_banks * 0x4000 + chr_banks * 0x2000, 0)
+        , m_prg_size(prg_banks * 0x4000)
+    {
+        m_image[0] = 'N';
+        m_image[1] = 'E';
+        m_image[2] = 'S';
+        m_image[3] = 0x1A;
+        m_image[4] = static_cast<char>(prg_banks);
+        m_image[5] = static_cast<char>(chr_banks);
+        m_image[6] = static_cast<char>((mapper_number & 0x0F) << 4);
+        m_image[7] = static_cast<char>(mapper_number & 0xF0);
+    }
+
+    ~test_rom()
+    {
+        if (m_written)
+        {
+            std::remove(m_path.c_str());
+        }
+    }
+
+    test_rom(const test_rom&) = delete;
+    auto operator=(const test_rom&) -> test_rom& = delete;
+
+    auto prg() -> char*
+    {
+        return m_image.data() + header_size;
+    }
+
+    auto prg_size() const -> int
+    {
+        return m_prg_size;
+    }
+
+    auto chr() -> char*
+    {
+        return m_image.data() + header_size + m_prg_size;
+    }
+
+    auto chr_size() const -> int
+    {
+        return static_cast<int>(m_image.size()) - header_size - m_prg_size;
+    }
+
+    // Writes the file as it stands and returns its path
+    auto write() -> const std::string&
+    {
+        std::ofstream rom(m_path, std::ofstream::binary);
+        rom.write(m_image.data(), static_cast<std::streamsize>(m_image.size()));
+        m_written = true;
+
+        return m_path;
+    }
+};
+
+inline int failures = 0;
+
+inline auto check(const std::string& what, long long got, long long expected) -> void
+{
+    if (got != expected)
+    {
+        printf("%s: got %lld, expected %lld\n", what.c_str(), got, expected);
+        failures++;
+    }
+}
+
+#endif  // CYGNES_TEST_FIXTURES_HPP